@@ -0,0 +1,31 @@
+// Checks and microbenchmarks for the simulation's hot paths. Not part of
+// the game binary; build the FaceOfBattleBench target and run it from a
+// release build.
+//
+//   FaceOfBattleBench [records...]
+//
+// Checks the SIMD separation kernel against its scalar reference and times
+// each path, then times the spatial index build for each record count given
+// (by default the shipped battle size and two larger armies). Exits non-zero
+// if a check fails.
+
+#include "benchmarks.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> recordCounts;
+    for (int i = 1; i < argc; ++i) {
+        recordCounts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (recordCounts.empty()) {
+        recordCounts = {1000, 20000, 100000};
+    }
+
+    bool ok = fob::bench::checkSeparationKernel();
+    for (size_t records : recordCounts) {
+        fob::bench::benchSpatialBuild(records);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace fob::bench {
+
+/// Time the FlatGrid fine level's serial build against the parallel build
+/// at a range of thread counts, on `records` soldiers spread over two
+/// opposing battle lines.
+void benchSpatialBuild(size_t records);
+
+/// Check every SIMD separation path the host can run against the scalar
+/// reference on random neighbourhoods - within the tolerance documented on
+/// computeSeparation, identical contact flags - and that computeSeparation
+/// dispatches to the widest of them; then time each path. Returns false if
+/// any check fails.
+bool checkSeparationKernel();
+
+} // namespace fob::bench
@@ -0,0 +1,162 @@
+#include "benchmarks.hpp"
+#include "core/constants.hpp"
+#include "simulation/separation_kernel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace fob::bench {
+
+namespace {
+
+// Relative tolerance documented on computeSeparation
+constexpr float SEPARATION_TOLERANCE = 1e-5f;
+
+// Timed results are written here so the loops can't be optimised away
+volatile float g_sink = 0.0f;
+
+/// One soldier and their packed neighbours.
+struct Neighbourhood {
+    float x = 0.0f;
+    float y = 0.0f;
+    int32_t team = 0;
+    std::vector<float> nx;
+    std::vector<float> ny;
+    std::vector<int32_t> nteam;
+};
+
+/// Random neighbourhoods of every size up to a full contact line, with
+/// neighbours in and out of both push radii and a few on top of the soldier.
+std::vector<Neighbourhood> randomNeighbourhoods(size_t count) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+    std::uniform_int_distribution<int> size(0, 64);
+    std::uniform_int_distribution<int> coin(0, 1);
+    std::uniform_int_distribution<int> rare(0, 15);
+
+    std::vector<Neighbourhood> result(count);
+    for (auto& hood : result) {
+        hood.x = offset(rng) * 100.0f;
+        hood.y = offset(rng) * 100.0f;
+        hood.team = coin(rng);
+        int n = size(rng);
+        for (int i = 0; i < n; ++i) {
+            bool onTop = rare(rng) == 0;
+            hood.nx.push_back(hood.x + (onTop ? 0.001f : offset(rng)));
+            hood.ny.push_back(hood.y + (onTop ? 0.0f : offset(rng)));
+            hood.nteam.push_back(coin(rng));
+        }
+    }
+    return result;
+}
+
+SeparationForces run(SimdPath path, const Neighbourhood& hood) {
+    return computeSeparationOn(path, hood.x, hood.y, hood.team, hood.nx.data(), hood.ny.data(),
+                               hood.nteam.data(), hood.nx.size());
+}
+
+/// Whether `path` agrees with the scalar reference on `hood`: each component
+/// within the tolerance of the summed magnitudes of its per-neighbour terms,
+/// and the same contact flag.
+bool matchesScalar(SimdPath path, const Neighbourhood& hood) {
+    SeparationForces reference = run(SimdPath::Scalar, hood);
+    SeparationForces result = run(path, hood);
+
+    // Summed magnitudes, term by term through the scalar path
+    SeparationForces magnitude;
+    for (size_t i = 0; i < hood.nx.size(); ++i) {
+        SeparationForces term = computeSeparationOn(SimdPath::Scalar, hood.x, hood.y, hood.team,
+                                                    &hood.nx[i], &hood.ny[i], &hood.nteam[i], 1);
+        magnitude.enemyX += std::abs(term.enemyX);
+        magnitude.enemyY += std::abs(term.enemyY);
+        magnitude.allyX += std::abs(term.allyX);
+        magnitude.allyY += std::abs(term.allyY);
+    }
+
+    auto close = [](float a, float b, float scale) {
+        return std::abs(a - b) <= SEPARATION_TOLERANCE * std::max(scale, 1.0f);
+    };
+    return result.enemyContact == reference.enemyContact &&
+           close(result.enemyX, reference.enemyX, magnitude.enemyX) &&
+           close(result.enemyY, reference.enemyY, magnitude.enemyY) &&
+           close(result.allyX, reference.allyX, magnitude.allyX) &&
+           close(result.allyY, reference.allyY, magnitude.allyY);
+}
+
+/// The widest path this host supports, found independently of the kernel's
+/// own dispatch.
+SimdPath expectedPath() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdPath::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdPath::SSE2;
+#endif
+    return SimdPath::Scalar;
+}
+
+bool sameForces(const SeparationForces& a, const SeparationForces& b) {
+    return a.enemyX == b.enemyX && a.enemyY == b.enemyY && a.allyX == b.allyX &&
+           a.allyY == b.allyY && a.enemyContact == b.enemyContact;
+}
+
+} // anonymous namespace
+
+bool checkSeparationKernel() {
+    constexpr size_t NEIGHBOURHOODS = 20000;
+    constexpr int REPEATS = 20;
+    const std::vector<Neighbourhood> hoods = randomNeighbourhoods(NEIGHBOURHOODS);
+    bool ok = true;
+
+    const SimdPath dispatched = separationSimdPath();
+    std::cout << "Separation kernel dispatches to " << simdPathName(dispatched) << std::endl;
+    if (dispatched != expectedPath()) {
+        std::cout << "  FAIL: expected " << simdPathName(expectedPath()) << std::endl;
+        ok = false;
+    }
+
+    // computeSeparation must be exactly the dispatched path
+    for (const auto& hood : hoods) {
+        SeparationForces viaDispatch = computeSeparation(hood.x, hood.y, hood.team, hood.nx.data(),
+                                                         hood.ny.data(), hood.nteam.data(),
+                                                         hood.nx.size());
+        if (!sameForces(viaDispatch, run(dispatched, hood))) {
+            std::cout << "  FAIL: computeSeparation differs from the " << simdPathName(dispatched)
+                      << " path" << std::endl;
+            ok = false;
+            break;
+        }
+    }
+
+    for (SimdPath path : {SimdPath::Scalar, SimdPath::SSE2, SimdPath::AVX2}) {
+        if (path > dispatched) break;  // paths are ordered by width; the host can't run it
+
+        size_t mismatches = 0;
+        for (const auto& hood : hoods) {
+            if (!matchesScalar(path, hood)) ++mismatches;
+        }
+
+        double best = 1e30;
+        float sink = 0.0f;
+        for (int rep = 0; rep < REPEATS; ++rep) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& hood : hoods) {
+                sink += run(path, hood).allyX;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        g_sink = sink;
+
+        std::cout << "  " << simdPathName(path) << ": " << best << "ms for " << NEIGHBOURHOODS
+                  << " soldiers, " << mismatches << " outside tolerance" << std::endl;
+        if (mismatches > 0) ok = false;
+    }
+    return ok;
+}
+
+} // namespace fob::bench
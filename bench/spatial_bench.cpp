@@ -0,0 +1,63 @@
+#include "benchmarks.hpp"
+#include "core/constants.hpp"
+#include "core/job_system.hpp"
+#include "simulation/spatial_hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace fob::bench {
+
+namespace {
+
+/// `records` soldiers spread over two opposing battle lines.
+std::vector<SpatialEntry> battleLines(size_t records) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> alongLine(-400.0f, 400.0f);
+    std::uniform_real_distribution<float> depth(0.0f, 60.0f);
+    std::vector<SpatialEntry> soldiers;
+    soldiers.reserve(records);
+    for (size_t i = 0; i < records; ++i) {
+        Team::Value team = (i & 1) ? Team::Blue : Team::Red;
+        float y = team == Team::Red ? -depth(rng) : depth(rng);
+        soldiers.push_back({static_cast<entt::entity>(i), alongLine(rng), y, team, false});
+    }
+    return soldiers;
+}
+
+} // anonymous namespace
+
+void benchSpatialBuild(size_t records) {
+    constexpr int REPEATS = 50;
+    std::cout << "FlatGrid build, " << records << " records, best of " << REPEATS << ":" << std::endl;
+
+    const std::vector<SpatialEntry> soldiers = battleLines(records);
+
+    auto timeBuilds = [&](auto&& build) {
+        SpatialHash index(SPATIAL_FINE_CELL_SIZE, SpatialHash::Backend::FlatGrid);
+        double best = 1e30;
+        for (int rep = 0; rep < REPEATS; ++rep) {
+            index.clear();
+            for (const auto& soldier : soldiers) {
+                index.insert(soldier.entity, soldier.x, soldier.y, soldier.team);
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            build(index);
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    };
+
+    std::cout << "  serial:     " << timeBuilds([](SpatialHash& index) { index.build(); }) << "ms" << std::endl;
+    for (unsigned threads : {2u, 4u, 8u, 16u, 32u}) {
+        JobSystem jobs(threads);
+        double ms = timeBuilds([&](SpatialHash& index) { index.build(jobs); });
+        std::cout << "  " << threads << " threads: " << (threads < 10 ? " " : "") << ms << "ms" << std::endl;
+    }
+}
+
+} // namespace fob::bench
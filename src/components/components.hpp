@@ -1,7 +1,11 @@
 #pragma once
 
 #include "core/types.hpp"
+#include "core/oriented_box.hpp"
 #include <entt/entt.hpp>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 
 namespace fob {
 
@@ -33,6 +37,7 @@ struct Velocity {
 
 struct Team {
     enum Value : uint8_t { Red, Blue };
+    static constexpr int COUNT = 2;
     Value value = Red;
 
     Team() = default;
@@ -99,6 +104,20 @@ enum class FormationState : uint8_t {
     Broken       // Formation has collapsed, every man for himself
 };
 
+/// Maps a member's localOffset to the world: local x runs along the
+/// formation's right (facing turned a quarter clockwise), local y along its
+/// facing, both from the formation's position.
+struct SlotTransform {
+    Vec2 origin;
+    Vec2 right;
+    Vec2 forward;
+
+    Vec2 apply(Vec2 local) const {
+        return Vec2(origin.x + right.x * local.x + forward.x * local.y,
+                    origin.y + right.y * local.x + forward.y * local.y);
+    }
+};
+
 /// Component for formation entities (the formation itself, not its members)
 struct Formation {
     Vec2 targetPosition = {0.0f, 0.0f};  // Where the formation is trying to go
@@ -107,9 +126,58 @@ struct Formation {
     float speed = 5.0f;                  // Formation advance speed
     int frontRank = 0;                   // Which rank is currently at the front
 
+    /// Soldiers standing in the formation - alive and not routing - in no
+    /// particular order. Maintained by FormationSystem (addMember,
+    /// removeMember, transferMember); each member's memberIndex is its slot.
+    std::vector<entt::entity> members;
+
+    /// Who stands where: a ranks x files grid, rank-major with rank 0 at the
+    /// front, holding entt::null for empty places. Kept in step with members
+    /// and with each member's rank and file.
+    int ranks = 0;
+    int files = 0;
+    std::vector<entt::entity> grid;
+
+    /// Box around the members' positions, aligned with facing. Refreshed by
+    /// FormationSystem each tick; meaningless while members is empty.
+    OrientedBox bounds;
+
+    /// Level of detail: set by FormationSystem while the formation advances
+    /// with no enemy within FORMATION_LOD_MARGIN of its bounds. Members of a
+    /// rigid formation are moved straight to their slots, with no per-soldier
+    /// steering.
+    bool rigid = false;
+
     Formation() = default;
     Formation(Vec2 target, Vec2 face, float spd = 5.0f)
         : targetPosition(target), facing(face), speed(spd) {}
+
+    /// The transform placing member slots with the formation at `origin`.
+    /// Facing is normalized here, so slot spacing holds even if it has
+    /// drifted from unit length; a zero facing falls back to the default.
+    SlotTransform slotTransform(Vec2 origin) const {
+        float len = std::sqrt(facing.x * facing.x + facing.y * facing.y);
+        Vec2 forward = len > 0.0001f ? Vec2(facing.x / len, facing.y / len) : Vec2(0.0f, 1.0f);
+        return SlotTransform{origin, Vec2(forward.y, -forward.x), forward};
+    }
+
+    /// Size the grid for `rankCount` ranks of `fileCount` files, all empty.
+    void resizeGrid(int rankCount, int fileCount) {
+        ranks = rankCount;
+        files = fileCount;
+        grid.assign(static_cast<size_t>(rankCount) * fileCount, entt::null);
+    }
+
+    bool inGrid(int rank, int file) const {
+        return rank >= 0 && rank < ranks && file >= 0 && file < files;
+    }
+
+    /// The soldier at a place, or entt::null if it is empty or off the grid.
+    entt::entity occupant(int rank, int file) const {
+        return inGrid(rank, file) ? grid[rank * files + file] : entt::entity{entt::null};
+    }
+
+    entt::entity& place(int rank, int file) { return grid[rank * files + file]; }
 };
 
 /// Component for soldiers belonging to a formation
@@ -118,6 +186,10 @@ struct FormationMember {
     Vec2 localOffset = {0.0f, 0.0f};      // Position relative to formation center
     int rank = 0;                          // Row: 0 = front, 1 = second, etc.
     int file = 0;                          // Column position
+    uint32_t memberIndex = NOT_LISTED;     // Slot in Formation::members
+
+    /// memberIndex of a soldier who has left the ranks (dead or routing).
+    static constexpr uint32_t NOT_LISTED = UINT32_MAX;
 
     FormationMember() = default;
     FormationMember(entt::entity form, Vec2 offset, int r, int f)
@@ -125,17 +197,28 @@ struct FormationMember {
 };
 
 // ============================================================================
-// State Tags (presence/absence indicates state)
+// Combat
 // ============================================================================
 
-struct InCombat {
+/// Melee engagement. Every soldier carries one for life, so entering and
+/// leaving combat only flips `engaged` instead of adding or removing a
+/// component. Soldiers engage when an enemy comes within ATTACK_RANGE and
+/// only disengage once none is within ATTACK_DISENGAGE_RANGE, so soldiers
+/// jostling at the edge of reach don't flicker in and out of combat.
+///
+/// Cooldowns aren't counted down: CombatSystem schedules the next attack on
+/// a timing wheel and sets attackReady when that tick comes round.
+struct CombatState {
     entt::entity opponent = entt::null;
-    float combatTimer = 0.0f;  // time since last attack
-
-    InCombat() = default;
-    InCombat(entt::entity opp) : opponent(opp), combatTimer(0.0f) {}
+    uint32_t nextAttackTick = 0;  // tick the pending cooldown ends
+    bool engaged = false;
+    bool attackReady = false;     // cooldown over; strikes once the opponent is in reach
 };
 
+// ============================================================================
+// State Tags (presence/absence indicates state)
+// ============================================================================
+
 struct Routing {};   // unit is fleeing
 struct Dead {};      // unit is dead (kept for rendering corpses, etc.)
 
@@ -153,14 +236,14 @@ struct Pursuing {
 struct FlashEffect {
     enum Type : uint8_t { None, Attack, Hit };
     Type type = None;
-    float timer = 0.0f;  // Time remaining on flash
+    uint32_t expiresAt = 0;  // Tick the flash is cleared on
 
     static constexpr float FLASH_DURATION = 0.15f;
 
     FlashEffect() = default;
-    FlashEffect(Type t) : type(t), timer(FLASH_DURATION) {}
+    FlashEffect(Type t, uint32_t expires) : type(t), expiresAt(expires) {}
 
-    bool isActive() const { return timer > 0.0f && type != None; }
+    bool isActive() const { return type != None; }
 };
 
 // ============================================================================
@@ -1,23 +1,41 @@
 #pragma once
 
+#include <cstdint>
+
 namespace fob {
 
 // Simulation
 constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
 
+/// Whole ticks for `seconds` of simulated time to elapse, rounded up.
+constexpr uint32_t ticksFor(float seconds) {
+    uint32_t ticks = static_cast<uint32_t>(seconds / FIXED_TIMESTEP);
+    return ticks * FIXED_TIMESTEP < seconds ? ticks + 1 : ticks;
+}
+
 // Spatial
 constexpr float MELEE_RANGE = 2.0f;
 constexpr float FORMATION_SPACING = 2.5f;
 constexpr float MORALE_EFFECT_RADIUS = 20.0f;
-constexpr float SPATIAL_HASH_CELL_SIZE = 10.0f;
+constexpr float SPATIAL_FINE_CELL_SIZE = 4.0f;     // Contact-range queries and neighbour-list rebuilds
+constexpr float SPATIAL_COARSE_CELL_SIZE = 20.0f;  // Morale-radius queries
+constexpr float BATTLEFIELD_HALF_EXTENT = 1000.0f;  // Flat spatial grid covers [-E, E] on both axes
 
 // Separation / Collision avoidance
 constexpr float ALLY_SEPARATION_RADIUS = 2.0f;    // Start separating when closer than this
 constexpr float ALLY_SEPARATION_STRENGTH = 8.0f;  // How strongly to push apart
 constexpr float ENEMY_STOP_RADIUS = 2.5f;         // Stop advancing when enemy within this range
 
+// Formation level of detail
+constexpr float FORMATION_LOD_MARGIN = 15.0f;     // Enemy-free margin for rigid movement
+
+// Neighbour lists
+constexpr float NEIGHBOUR_INTERACTION_RADIUS = 3.5f;  // Widest per-soldier query
+constexpr float NEIGHBOUR_LIST_SKIN = 2.5f;           // Slack before a list rebuild
+
 // Combat
-constexpr float ATTACK_RANGE = 3.0f;              // Distance at which soldiers can attack (must be >= ENEMY_STOP_RADIUS)
+constexpr float ATTACK_RANGE = 3.0f;              // Distance at which soldiers can attack
+constexpr float ATTACK_DISENGAGE_RANGE = 3.5f;    // Engaged soldiers leave combat beyond this
 constexpr float ATTACK_COOLDOWN = 1.5f;           // Seconds between attacks
 constexpr float LIGHT_DAMAGE = 15.0f;             // Damage on light hit
 constexpr float HEAVY_DAMAGE = 35.0f;             // Damage on heavy hit
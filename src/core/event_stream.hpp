@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/job_system.hpp"
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace fob {
+
+/// Double-buffered stream of one event type, one batch per tick.
+///
+/// Producers publish() into the current tick's batch from any JobSystem
+/// thread: each thread appends to its own buffer, so there are no locks or
+/// atomics on the hot path. At the end of the tick flip() merges the buffers
+/// into the published batch, which consumers read during the next tick via
+/// events() while new events accumulate behind it.
+///
+/// Event types carry an `entity` member - the soldier the event is about -
+/// and each batch is ordered by it, so consumers see the same order however
+/// the producing work was split across threads. Events about the same entity
+/// keep their publish order when published from one thread.
+template<typename Event>
+class EventStream {
+public:
+    explicit EventStream(const JobSystem& jobs) : m_jobs(jobs) {
+        m_pending.prepare(jobs);
+    }
+
+    /// Add an event to the current tick's batch.
+    void publish(const Event& event) { m_pending.local(m_jobs).push_back(event); }
+
+    /// The batch published by the last flip().
+    const std::vector<Event>& events() const { return m_published; }
+
+    /// Close the current tick's batch and publish it. Call once per tick,
+    /// with no producers running.
+    void flip() {
+        m_published.clear();
+        for (auto& pending : m_pending) {
+            m_published.insert(m_published.end(), pending.begin(), pending.end());
+            pending.clear();
+        }
+        std::stable_sort(m_published.begin(), m_published.end(), [](const Event& a, const Event& b) {
+            return entt::to_integral(a.entity) < entt::to_integral(b.entity);
+        });
+    }
+
+private:
+    const JobSystem& m_jobs;
+    PerWorker<std::vector<Event>> m_pending;
+    std::vector<Event> m_published;
+};
+
+} // namespace fob
@@ -0,0 +1,178 @@
+#include "core/job_system.hpp"
+#include <algorithm>
+
+namespace fob {
+
+namespace {
+
+// Which JobSystem thread the current OS thread is, if any
+struct WorkerIdentity {
+    const JobSystem* system = nullptr;
+    unsigned index = 0;
+};
+
+thread_local WorkerIdentity t_worker;
+
+} // anonymous namespace
+
+JobSystem::JobSystem(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    t_worker = {this, 0};
+    m_workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; ++i) {
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    if (t_worker.system == this) {
+        t_worker = {};
+    }
+}
+
+unsigned JobSystem::currentWorker() const {
+    return t_worker.system == this ? t_worker.index : 0;
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)>& fn) {
+    if (begin >= end) return;
+    grain = std::max<size_t>(grain, 1);
+
+    const size_t count = end - begin;
+    if (threadCount() == 1 || count <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    TaskGroup group;
+    const size_t chunks = (count + grain - 1) / grain;
+    group.m_pending.store(chunks, std::memory_order_relaxed);
+    for (size_t c = 0; c < chunks; ++c) {
+        Job job;
+        job.range = &fn;
+        job.begin = begin + count * c / chunks;
+        job.end = begin + count * (c + 1) / chunks;
+        job.group = &group;
+        push(std::move(job));
+    }
+    wait(group);
+}
+
+void JobSystem::run(unsigned chunks, const std::function<void(unsigned)>& fn) {
+    parallelFor(0, chunks, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+            fn(static_cast<unsigned>(c));
+        }
+    });
+}
+
+void JobSystem::spawn(TaskGroup& group, std::function<void()> task) {
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (threadCount() == 1) {
+        // Nobody else could pick it up; run it now
+        task();
+        group.m_pending.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    Job job;
+    job.task = std::move(task);
+    job.group = &group;
+    push(std::move(job));
+}
+
+void JobSystem::wait(TaskGroup& group) {
+    const unsigned self = currentWorker();
+    while (!group.done()) {
+        if (!tryRunOne(self)) {
+            // Our remaining jobs are running elsewhere
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::push(Job job) {
+    {
+        auto& queue = *m_queues[currentWorker()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        // Publish under the sleep mutex so a worker can't miss the wakeup
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::tryRunOne(unsigned self) {
+    Job job;
+    if (!popOwn(self, job) && !steal(self, job)) return false;
+    execute(job);
+    return true;
+}
+
+bool JobSystem::popOwn(unsigned self, Job& job) {
+    auto& queue = *m_queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::steal(unsigned self, Job& job) {
+    const unsigned count = threadCount();
+    for (unsigned offset = 1; offset < count; ++offset) {
+        auto& queue = *m_queues[(self + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) continue;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job) {
+    if (job.range) {
+        (*job.range)(job.begin, job.end);
+    } else {
+        job.task();
+    }
+    job.group->m_pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(unsigned index) {
+    t_worker = {this, index};
+    while (true) {
+        if (tryRunOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] {
+            return m_stopping || m_queuedJobs.load(std::memory_order_relaxed) > 0;
+        });
+        if (m_stopping) return;
+    }
+}
+
+} // namespace fob
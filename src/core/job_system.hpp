@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fob {
+
+/// Small work-stealing task scheduler shared by the simulation systems.
+///
+/// Every thread (the workers plus the thread that created the system) owns a
+/// job deque: it pushes and pops its own work at the back, and idle threads
+/// steal from the front of the others'. Waiting on a TaskGroup runs queued
+/// jobs instead of blocking, so fork/join calls can nest.
+///
+/// Thread 0 is the creating thread; workers are 1..threadCount()-1.
+/// Fork/join entry points must be called from one of these threads.
+class JobSystem {
+public:
+    /// Counts the outstanding jobs of one fork/join.
+    class TaskGroup {
+    public:
+        bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<size_t> m_pending{0};
+    };
+
+    /// @param threadCount Total threads including the caller; 0 picks the
+    ///        hardware concurrency.
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /// Total threads that run jobs, including the creating thread.
+    unsigned threadCount() const { return static_cast<unsigned>(m_queues.size()); }
+
+    /// Index of the calling thread in [0, threadCount()), for per-worker data.
+    unsigned currentWorker() const;
+
+    /// Split [begin, end) into ranges of about `grain` items and call
+    /// fn(rangeBegin, rangeEnd) for each, in parallel; returns when all are done.
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    /// Call fn(chunk) for every chunk in [0, chunks) and wait for all of them.
+    void run(unsigned chunks, const std::function<void(unsigned)>& fn);
+
+    /// Queue a task on the calling thread's deque as part of `group`.
+    void spawn(TaskGroup& group, std::function<void()> task);
+
+    /// Run queued jobs until every task of `group` has finished.
+    void wait(TaskGroup& group);
+
+private:
+    struct Job {
+        std::function<void()> task;                         // spawned task, or
+        const std::function<void(size_t, size_t)>* range = nullptr;  // a parallelFor range
+        size_t begin = 0;
+        size_t end = 0;
+        TaskGroup* group = nullptr;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void push(Job job);
+    bool tryRunOne(unsigned self);
+    bool popOwn(unsigned self, Job& job);
+    bool steal(unsigned self, Job& job);
+    void execute(Job& job);
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queuedJobs{0};
+    bool m_stopping = false;
+};
+
+/// One T per JobSystem thread, e.g. scratch buffers for a parallel loop.
+/// prepare() on the creating thread before going wide; local() from any job.
+template<typename T>
+class PerWorker {
+public:
+    void prepare(const JobSystem& jobs) {
+        if (m_items.size() < jobs.threadCount()) {
+            m_items.resize(jobs.threadCount());
+        }
+    }
+
+    T& local(const JobSystem& jobs) { return m_items[jobs.currentWorker()]; }
+
+    auto begin() { return m_items.begin(); }
+    auto end() { return m_items.end(); }
+
+private:
+    std::vector<T> m_items;
+};
+
+} // namespace fob
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/types.hpp"
+#include <cmath>
+
+namespace fob {
+
+/// A rectangle rotated to an arbitrary facing: `center`, a unit `forward`
+/// axis, and half-extents along right (x) and forward (y), where right is
+/// forward turned a quarter clockwise.
+struct OrientedBox {
+    Vec2 center = {0.0f, 0.0f};
+    Vec2 forward = {0.0f, 1.0f};
+    Vec2 halfExtents = {0.0f, 0.0f};
+
+    Vec2 right() const { return Vec2(forward.y, -forward.x); }
+
+    /// A zero-size box at a point.
+    static OrientedBox point(Vec2 p) { return OrientedBox{p, {0.0f, 1.0f}, {0.0f, 0.0f}}; }
+
+    /// Whether the two boxes come within `margin` of each other, by the
+    /// separating axis test on both boxes' axes. Boxes within `margin` always
+    /// pass; near a corner, boxes up to margin * sqrt(2) apart can pass too.
+    bool near(const OrientedBox& other, float margin) const {
+        const Vec2 offset = other.center - center;
+        const Vec2 axes[4] = {right(), forward, other.right(), other.forward};
+        for (const Vec2& axis : axes) {
+            float reach = radiusAlong(axis) + other.radiusAlong(axis) + margin;
+            if (std::abs(offset.x * axis.x + offset.y * axis.y) > reach) return false;
+        }
+        return true;
+    }
+
+private:
+    /// Half the box's extent projected onto a unit axis.
+    float radiusAlong(Vec2 axis) const {
+        const Vec2 r = right();
+        return halfExtents.x * std::abs(r.x * axis.x + r.y * axis.y) +
+               halfExtents.y * std::abs(forward.x * axis.x + forward.y * axis.y);
+    }
+};
+
+} // namespace fob
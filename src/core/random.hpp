@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace fob {
+
+/// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011).
+///
+/// There is no generator state to advance: every draw is a pure function of
+/// the seed and a 128-bit counter. Callers build the counter from whatever
+/// identifies the draw - for combat, (tick, entity, draw index) - so results
+/// don't depend on the order draws are made in or which thread makes them,
+/// and a battle replays exactly from its seed.
+class CounterRng {
+public:
+    using Counter = std::array<uint32_t, 4>;
+
+    explicit CounterRng(uint64_t seed = 0)
+        : m_key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    /// The raw Philox block for a counter: four independent uniform words.
+    Counter block(Counter counter) const {
+        std::array<uint32_t, 2> key = m_key;
+        for (int round = 0; round < ROUNDS; ++round) {
+            if (round > 0) {
+                key[0] += WEYL_0;
+                key[1] += WEYL_1;
+            }
+            uint64_t product0 = static_cast<uint64_t>(MULTIPLIER_0) * counter[0];
+            uint64_t product1 = static_cast<uint64_t>(MULTIPLIER_1) * counter[2];
+            counter = {
+                static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(product1),
+                static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(product0),
+            };
+        }
+        return counter;
+    }
+
+    /// Uniform float in [0, 1) for draw `draw` of `stream` on `tick`.
+    float uniform(uint32_t tick, uint32_t stream, uint32_t draw) const {
+        return toUnitFloat(block({tick, stream, draw, 0})[0]);
+    }
+
+    /// Uniform float between lo and hi.
+    float uniform(uint32_t tick, uint32_t stream, uint32_t draw, float lo, float hi) const {
+        return lo + (hi - lo) * uniform(tick, stream, draw);
+    }
+
+    /// Top 24 bits of a word as a float in [0, 1).
+    static float toUnitFloat(uint32_t bits) {
+        return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    static constexpr int ROUNDS = 10;
+    static constexpr uint32_t MULTIPLIER_0 = 0xD2511F53u;
+    static constexpr uint32_t MULTIPLIER_1 = 0xCD9E8D57u;
+    static constexpr uint32_t WEYL_0 = 0x9E3779B9u;
+    static constexpr uint32_t WEYL_1 = 0xBB67AE85u;
+
+    std::array<uint32_t, 2> m_key;
+};
+
+} // namespace fob
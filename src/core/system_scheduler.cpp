@@ -0,0 +1,96 @@
+#include "core/system_scheduler.hpp"
+#include <algorithm>
+
+namespace fob {
+
+namespace {
+
+bool overlaps(const std::vector<const void*>& a, const std::vector<const void*>& b) {
+    for (const void* id : a) {
+        if (std::find(b.begin(), b.end(), id) != b.end()) return true;
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+bool SystemAccess::conflictsWith(const SystemAccess& other) const {
+    return overlaps(m_writes, other.m_writes) ||
+           overlaps(m_writes, other.m_reads) ||
+           overlaps(m_reads, other.m_writes);
+}
+
+void SystemScheduler::add(std::string name, SystemAccess access, SystemFn run) {
+    System system{std::move(name), std::move(access), std::move(run), {}, {}};
+
+    // Keep the serial order against every earlier system it conflicts with
+    const size_t index = m_systems.size();
+    for (size_t earlier = 0; earlier < index; ++earlier) {
+        if (system.access.conflictsWith(m_systems[earlier].access)) {
+            system.dependencies.push_back(earlier);
+            m_systems[earlier].dependents.push_back(index);
+        }
+    }
+
+    m_systems.push_back(std::move(system));
+    m_remaining = std::vector<std::atomic<size_t>>(m_systems.size());
+    m_preparedFor = nullptr;
+}
+
+void SystemScheduler::prepare(entt::registry& registry) {
+    if (m_preparedFor == &registry) return;
+
+    // Create every pool up front: systems running side by side may look up
+    // storages, but must never add one to the registry concurrently
+    for (const auto& system : m_systems) {
+        for (auto storage : system.access.m_storages) {
+            storage(registry);
+        }
+    }
+    m_preparedFor = &registry;
+}
+
+void SystemScheduler::run(entt::registry& registry, JobSystem& jobs) {
+    prepare(registry);
+
+    for (size_t i = 0; i < m_systems.size(); ++i) {
+        m_remaining[i].store(m_systems[i].dependencies.size(), std::memory_order_relaxed);
+    }
+
+    JobSystem::TaskGroup group;
+    for (size_t i = 0; i < m_systems.size(); ++i) {
+        if (m_systems[i].dependencies.empty()) {
+            launch(i, jobs, group);
+        }
+    }
+    jobs.wait(group);
+}
+
+void SystemScheduler::launch(size_t index, JobSystem& jobs, JobSystem::TaskGroup& group) {
+    jobs.spawn(group, [this, index, &jobs, &group] {
+        m_systems[index].run();
+        for (size_t dependent : m_systems[index].dependents) {
+            if (m_remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                launch(dependent, jobs, group);
+            }
+        }
+    });
+}
+
+std::string SystemScheduler::describe() const {
+    std::string out;
+    for (const auto& system : m_systems) {
+        out += system.name;
+        if (!system.dependencies.empty()) {
+            out += " <-";
+            for (size_t dependency : system.dependencies) {
+                out += ' ';
+                out += m_systems[dependency].name;
+            }
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace fob
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "core/job_system.hpp"
+#include <entt/entt.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fob {
+
+/// What a system touches: the components it reads and writes, plus any
+/// shared non-component state (spatial index, neighbour lists, ...) it reads
+/// or writes. Adding or removing a component counts as writing it.
+///
+///     SystemAccess().read<Position, Team>().write<Velocity>()
+///                   .readResource<NeighbourLists>()
+class SystemAccess {
+public:
+    template<typename... Components>
+    SystemAccess& read() {
+        (addComponent<Components>(m_reads), ...);
+        return *this;
+    }
+
+    template<typename... Components>
+    SystemAccess& write() {
+        (addComponent<Components>(m_writes), ...);
+        return *this;
+    }
+
+    template<typename... Resources>
+    SystemAccess& readResource() {
+        (m_reads.push_back(resourceId<Resources>()), ...);
+        return *this;
+    }
+
+    template<typename... Resources>
+    SystemAccess& writeResource() {
+        (m_writes.push_back(resourceId<Resources>()), ...);
+        return *this;
+    }
+
+    /// Whether the two can't run at the same time: one writes something the
+    /// other reads or writes.
+    bool conflictsWith(const SystemAccess& other) const;
+
+private:
+    friend class SystemScheduler;
+
+    using ResourceId = const void*;
+    using StorageFn = void (*)(entt::registry&);
+
+    /// A unique address per type, standing in for a type id.
+    template<typename T>
+    static ResourceId resourceId() {
+        static const char tag = 0;
+        return &tag;
+    }
+
+    template<typename Component>
+    void addComponent(std::vector<ResourceId>& ids) {
+        ids.push_back(resourceId<Component>());
+        m_storages.push_back([](entt::registry& registry) { registry.storage<Component>(); });
+    }
+
+    std::vector<ResourceId> m_reads;
+    std::vector<ResourceId> m_writes;
+    std::vector<StorageFn> m_storages;
+};
+
+/// Runs the systems of one fixed-step tick as a dependency graph.
+///
+/// Systems are added in their logical order. Each depends on every earlier
+/// system whose access conflicts with its own, so the result is the same as
+/// running them one after another in that order - but systems with no
+/// conflict between them (e.g. flash decay and formation contact checks) run
+/// concurrently on the JobSystem. Systems may go wide inside with
+/// parallelFor as usual.
+class SystemScheduler {
+public:
+    using SystemFn = std::function<void()>;
+
+    /// Append a system to the tick.
+    void add(std::string name, SystemAccess access, SystemFn run);
+
+    /// Run every system once, respecting the dependency graph. Must be
+    /// called from the thread that created `jobs`.
+    void run(entt::registry& registry, JobSystem& jobs);
+
+    size_t size() const { return m_systems.size(); }
+
+    /// Human-readable graph: each system with the systems it waits on.
+    std::string describe() const;
+
+private:
+    struct System {
+        std::string name;
+        SystemAccess access;
+        SystemFn run;
+        std::vector<size_t> dependents;   // systems that wait on this one
+        std::vector<size_t> dependencies; // systems this one waits on
+    };
+
+    void prepare(entt::registry& registry);
+    void launch(size_t index, JobSystem& jobs, JobSystem::TaskGroup& group);
+
+    std::vector<System> m_systems;
+    std::vector<std::atomic<size_t>> m_remaining;  // unfinished dependencies this tick
+    entt::registry* m_preparedFor = nullptr;
+};
+
+} // namespace fob
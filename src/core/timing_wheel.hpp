@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fob {
+
+/// Hierarchical timing wheel keyed on simulation tick.
+///
+/// Four levels of 256 slots: level 0 holds items due within the current
+/// 256-tick block, one slot per tick; each level above covers a 256x longer
+/// span per slot. Whenever the wheel's tick crosses a block boundary, the
+/// next slot of the level above is cascaded down. Scheduling is O(1), and
+/// advancing a tick costs the items that fire plus an occasional cascade, no
+/// matter how many items are pending.
+///
+/// There is no cancellation: owners check when an item pops that it is still
+/// wanted (e.g. by comparing against a due tick stored on the component).
+/// Ticks are 32-bit, which wraps after ~2 years at 60 ticks per second.
+template<typename T>
+class TimingWheel {
+public:
+    explicit TimingWheel(uint32_t now = 0) : m_slots(SLOTS * LEVELS), m_now(now) {}
+
+    /// The last tick the wheel has advanced to.
+    uint32_t now() const { return m_now; }
+
+    /// Number of items still pending.
+    size_t size() const { return m_size; }
+
+    /// Queue an item to pop at tick `due`. Items due at or before now() pop
+    /// on the next advanceTo().
+    void schedule(uint32_t due, T item) {
+        if (due <= m_now) {
+            m_overdue.push_back({due, std::move(item)});
+        } else {
+            place({due, std::move(item)});
+        }
+        ++m_size;
+    }
+
+    /// Step the wheel to `tick`, appending every item that has come due to
+    /// `due` (in no particular order).
+    void advanceTo(uint32_t tick, std::vector<T>& due) {
+        popAll(m_overdue, due);
+
+        while (m_now != tick) {
+            ++m_now;
+
+            // On a block boundary, bring the next slot of each level that
+            // rolled over down a level, from the top
+            if ((m_now & SLOT_MASK) == 0) {
+                unsigned level = 1;
+                while (level + 1 < LEVELS && ((m_now >> (SLOT_BITS * level)) & SLOT_MASK) == 0) {
+                    ++level;
+                }
+                for (; level >= 1; --level) {
+                    cascade(level);
+                }
+            }
+
+            popAll(m_slots[m_now & SLOT_MASK], due);
+        }
+    }
+
+    /// Drop every pending item.
+    void clear() {
+        for (auto& slot : m_slots) {
+            slot.clear();
+        }
+        m_overdue.clear();
+        m_size = 0;
+    }
+
+private:
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t SLOT_MASK = SLOTS - 1;
+    static constexpr unsigned LEVELS = 4;
+
+    struct Entry {
+        uint32_t due;
+        T item;
+    };
+
+    /// File an entry due at or after now() in the lowest level whose current
+    /// block contains it.
+    void place(Entry entry) {
+        unsigned level = 0;
+        while (level + 1 < LEVELS &&
+               (entry.due >> (SLOT_BITS * (level + 1))) != (m_now >> (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        uint32_t slot = (entry.due >> (SLOT_BITS * level)) & SLOT_MASK;
+        m_slots[level * SLOTS + slot].push_back(std::move(entry));
+    }
+
+    void cascade(unsigned level) {
+        auto& slot = m_slots[level * SLOTS + ((m_now >> (SLOT_BITS * level)) & SLOT_MASK)];
+        m_cascading.swap(slot);
+        for (auto& entry : m_cascading) {
+            place(std::move(entry));
+        }
+        m_cascading.clear();
+    }
+
+    void popAll(std::vector<Entry>& slot, std::vector<T>& due) {
+        for (auto& entry : slot) {
+            due.push_back(std::move(entry.item));
+        }
+        m_size -= slot.size();
+        slot.clear();
+    }
+
+    std::vector<std::vector<Entry>> m_slots;  // LEVELS x SLOTS
+    std::vector<Entry> m_overdue;
+    std::vector<Entry> m_cascading;
+    uint32_t m_now;
+    size_t m_size = 0;
+};
+
+} // namespace fob
@@ -2,10 +2,7 @@
 #include "core/constants.hpp"
 #include "components/components.hpp"
 #include "systems/render_system.hpp"
-#include "systems/movement_system.hpp"
-#include "systems/formation_system.hpp"
-#include "systems/combat_system.hpp"
-#include "simulation/spatial_hash.hpp"
+#include "simulation/simulation.hpp"
 
 #include <entt/entt.hpp>
 #include <SDL2/SDL.h>
@@ -13,6 +10,8 @@
 #include <iostream>
 #include <chrono>
 #include <cstring>
+#include <algorithm>
+#include <random>
 
 using namespace fob;
 
@@ -22,8 +21,11 @@ entt::entity spawnFormation(entt::registry& registry, Team::Value team,
                             Vec2 targetPos, Vec2 facing) {
     auto formationEntity = registry.create();
     registry.emplace<Position>(formationEntity, center);
-    registry.emplace<Formation>(formationEntity, targetPos, facing, HEAVY_INFANTRY_SPEED);
+    auto& formation = registry.emplace<Formation>(formationEntity, targetPos, facing, HEAVY_INFANTRY_SPEED);
     registry.emplace<Team>(formationEntity, team);
+    formation.members.reserve(rows * cols);
+    formation.resizeGrid(rows, cols);
+    const SlotTransform slots = formation.slotTransform(center);
 
     for (int rank = 0; rank < rows; ++rank) {
         for (int file = 0; file < cols; ++file) {
@@ -34,16 +36,15 @@ entt::entity spawnFormation(entt::registry& registry, Team::Value team,
 
             Vec2 localOffset(localX, localY);
 
-            float worldX = center.x + localX;
-            float worldY = center.y + localY * facing.y;
-
-            registry.emplace<Position>(soldier, worldX, worldY);
+            registry.emplace<Position>(soldier, slots.apply(localOffset));
             registry.emplace<Velocity>(soldier, 0.0f, 0.0f);
             registry.emplace<Team>(soldier, team);
             registry.emplace<Stats>(soldier, 100.0f, 100.0f, 10.0f, 5.0f, HEAVY_INFANTRY_SPEED);
             registry.emplace<Morale>(soldier, 1.0f, 0.0f);
             registry.emplace<UnitType>(soldier, UnitType::HeavyInfantry);
             registry.emplace<FormationMember>(soldier, formationEntity, localOffset, rank, file);
+            FormationSystem::addMember(registry, soldier);
+            registry.emplace<CombatState>(soldier);
 
             if (file == cols / 2 && rank % 3 == 0) {
                 registry.emplace<Officer>(soldier, 1);
@@ -54,14 +55,32 @@ entt::entity spawnFormation(entt::registry& registry, Team::Value team,
     return formationEntity;
 }
 
-void runHeadless(int maxTicks) {
-    std::cout << "Running headless simulation for " << maxTicks << " ticks..." << std::endl;
+/// Parse a --spatial argument into a backend, defaulting to Incremental.
+SpatialHash::Backend parseSpatialBackend(const char* name) {
+    if (std::strcmp(name, "hashed") == 0) return SpatialHash::Backend::Hashed;
+    if (std::strcmp(name, "flat") == 0) return SpatialHash::Backend::FlatGrid;
+    if (std::strcmp(name, "incremental") != 0) {
+        std::cerr << "Unknown spatial backend '" << name << "', using incremental" << std::endl;
+    }
+    return SpatialHash::Backend::Incremental;
+}
+
+/// A fresh seed for runs that don't ask for one with --seed.
+uint64_t randomSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) | device();
+}
+
+void runHeadless(int maxTicks, SpatialHash::Backend spatialBackend, uint64_t seed,
+                 unsigned threadCount, bool printSchedule) {
+    std::cout << "Running headless simulation for " << maxTicks << " ticks (seed "
+              << seed << ")..." << std::endl;
 
     entt::registry registry;
-    FormationSystem formationSystem;
-    MovementSystem movementSystem;
-    CombatSystem combatSystem;
-    SpatialHash spatialHash;
+    Simulation simulation(registry, spatialBackend, seed, threadCount);
+    if (printSchedule) {
+        std::cout << "Tick systems (with dependencies):\n" << simulation.scheduler().describe();
+    }
 
     // Spawn armies
     spawnFormation(registry, Team::Red, Vec2(0.0f, -30.0f), 10, 50, FORMATION_SPACING,
@@ -69,38 +88,29 @@ void runHeadless(int maxTicks) {
     spawnFormation(registry, Team::Blue, Vec2(0.0f, 30.0f), 10, 50, FORMATION_SPACING,
                    Vec2(0.0f, -30.0f), Vec2(0.0f, -1.0f));
 
+    // Head count per team, kept current from each tick's death events
+    int alive[Team::COUNT] = {};
+    int dead = 0;
+    auto soldiers = registry.view<Team, Stats>();
+    for (auto entity : soldiers) {
+        alive[soldiers.get<Team>(entity).value]++;
+    }
+
     auto startTime = std::chrono::high_resolution_clock::now();
 
     for (int tick = 0; tick < maxTicks; ++tick) {
-        // Rebuild spatial hash
-        spatialHash.clear();
-        auto posView = registry.view<Position>(entt::exclude<Dead, Formation>);
-        for (auto entity : posView) {
-            const auto& pos = posView.get<Position>(entity);
-            spatialHash.insert(entity, pos.x, pos.y);
-        }
+        simulation.tick();
 
-        // Run systems
-        formationSystem.update(registry, spatialHash, FIXED_TIMESTEP);
-        movementSystem.update(registry, spatialHash, FIXED_TIMESTEP);
-        combatSystem.update(registry, spatialHash, FIXED_TIMESTEP);
+        for (const auto& death : simulation.events().events<DeathEvent>()) {
+            alive[death.team]--;
+            dead++;
+        }
 
         // Print stats every simulated second (60 ticks)
         if (tick % 60 == 0) {
-            int redAlive = 0, blueAlive = 0, dead = 0;
-            auto statsView = registry.view<Team, Stats>();
-            for (auto entity : statsView) {
-                if (registry.all_of<Dead>(entity)) {
-                    dead++;
-                } else if (statsView.get<Team>(entity).value == Team::Red) {
-                    redAlive++;
-                } else {
-                    blueAlive++;
-                }
-            }
             float simTime = tick * FIXED_TIMESTEP;
-            std::cout << "t=" << simTime << "s: Red=" << redAlive
-                      << " Blue=" << blueAlive << " Dead=" << dead << std::endl;
+            std::cout << "t=" << simTime << "s: Red=" << alive[Team::Red]
+                      << " Blue=" << alive[Team::Blue] << " Dead=" << dead << std::endl;
         }
     }
 
@@ -116,17 +126,29 @@ int main(int argc, char* argv[]) {
     // Check for headless mode
     bool headless = false;
     int headlessTicks = 6000;  // Default: 100 seconds of simulation
+    SpatialHash::Backend spatialBackend = SpatialHash::Backend::Incremental;
+    unsigned threadCount = 0;  // 0 = one per hardware thread
+    uint64_t seed = randomSeed();
+    bool printSchedule = false;  // Debug: list the tick's systems and what each waits on
 
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "--headless") == 0) {
             headless = true;
         } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
             headlessTicks = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spatial") == 0 && i + 1 < argc) {
+            spatialBackend = parseSpatialBackend(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--print-schedule") == 0) {
+            printSchedule = true;
         }
     }
 
     if (headless) {
-        runHeadless(headlessTicks);
+        runHeadless(headlessTicks, spatialBackend, seed, threadCount, printSchedule);
         return 0;
     }
 
@@ -162,13 +184,13 @@ int main(int argc, char* argv[]) {
     // Create ECS registry and systems
     entt::registry registry;
     RenderSystem renderSystem(renderer, WINDOW_WIDTH, WINDOW_HEIGHT);
-    FormationSystem formationSystem;
-    MovementSystem movementSystem;
-    CombatSystem combatSystem;
-    SpatialHash spatialHash;
+    Simulation simulation(registry, spatialBackend, seed, threadCount);
+    if (printSchedule) {
+        std::cout << "Tick systems (with dependencies):\n" << simulation.scheduler().describe();
+    }
 
     // Spawn two opposing armies
-    std::cout << "Spawning armies..." << std::endl;
+    std::cout << "Spawning armies (seed " << seed << ")..." << std::endl;
     spawnFormation(registry, Team::Red, Vec2(0.0f, -30.0f), 10, 50, FORMATION_SPACING,
                    Vec2(0.0f, 30.0f), Vec2(0.0f, 1.0f));
     spawnFormation(registry, Team::Blue, Vec2(0.0f, 30.0f), 10, 50, FORMATION_SPACING,
@@ -252,17 +274,7 @@ int main(int argc, char* argv[]) {
         }
 
         while (accumulator >= FIXED_TIMESTEP) {
-            spatialHash.clear();
-            auto posView = registry.view<Position>(entt::exclude<Dead, Formation>);
-            for (auto entity : posView) {
-                const auto& pos = posView.get<Position>(entity);
-                spatialHash.insert(entity, pos.x, pos.y);
-            }
-
-            formationSystem.update(registry, spatialHash, FIXED_TIMESTEP);
-            movementSystem.update(registry, spatialHash, FIXED_TIMESTEP);
-            combatSystem.update(registry, spatialHash, FIXED_TIMESTEP);
-
+            simulation.tick();
             accumulator -= FIXED_TIMESTEP;
         }
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/event_stream.hpp"
+#include "core/job_system.hpp"
+#include "components/components.hpp"
+#include <entt/entt.hpp>
+#include <tuple>
+
+namespace fob {
+
+// ============================================================================
+// Battle events
+//
+// Each event's `entity` is the soldier it is about; batches are ordered by it.
+// ============================================================================
+
+/// A soldier took damage.
+struct HitEvent {
+    entt::entity entity;    // The soldier hit
+    entt::entity attacker;
+    float damage;
+};
+
+/// A soldier died.
+struct DeathEvent {
+    entt::entity entity;    // The fallen soldier
+    entt::entity killer;
+    Team::Value team;
+    bool officer;
+    float x, y;             // Where they fell, for radius-based morale hits
+};
+
+/// A soldier landed a killing blow.
+struct KillEvent {
+    entt::entity entity;    // The killer
+    entt::entity victim;
+};
+
+/// A soldier broke and started to flee.
+struct RoutEvent {
+    entt::entity entity;    // The routing soldier
+    Team::Value team;
+    float x, y;
+};
+
+/// Per-tick streams of battle events, one EventStream per event type.
+///
+/// Systems publish during the tick from whichever JobSystem thread they run
+/// on; Simulation flips every stream at the end of the tick, so consumers
+/// read the whole of the previous tick's batch while the next one fills.
+/// Publishing never blocks and reading never races with it, so neither needs
+/// declaring to the SystemScheduler.
+class EventBus {
+public:
+    explicit EventBus(const JobSystem& jobs)
+        : m_streams(EventStream<HitEvent>(jobs), EventStream<DeathEvent>(jobs),
+                    EventStream<KillEvent>(jobs), EventStream<RoutEvent>(jobs)) {}
+
+    template<typename Event>
+    void publish(const Event& event) { stream<Event>().publish(event); }
+
+    /// Events of this type from the last completed tick.
+    template<typename Event>
+    const std::vector<Event>& events() const { return std::get<EventStream<Event>>(m_streams).events(); }
+
+    /// Publish this tick's events and start the next tick's batch.
+    void flip() {
+        std::apply([](auto&... streams) { (streams.flip(), ...); }, m_streams);
+    }
+
+private:
+    template<typename Event>
+    EventStream<Event>& stream() { return std::get<EventStream<Event>>(m_streams); }
+
+    std::tuple<EventStream<HitEvent>, EventStream<DeathEvent>,
+               EventStream<KillEvent>, EventStream<RoutEvent>> m_streams;
+};
+
+} // namespace fob
@@ -0,0 +1,76 @@
+#include "simulation/neighbour_lists.hpp"
+#include <algorithm>
+
+namespace fob {
+
+// A list holds everyone within NEIGHBOUR_INTERACTION_RADIUS + skin of where
+// it was built, and queries promise everyone within the interaction radius.
+// Two lists can be up to 2x REBUILD_DISTANCE stale relative to each other,
+// plus one more for the last rebuild, and the skin left over after that has
+// to absorb the fastest two soldiers (routing cavalry, 1.5x speed) closing
+// on each other for one tick.
+static_assert(NEIGHBOUR_LIST_SKIN - 3.0f * NeighbourLists::REBUILD_DISTANCE >=
+                  2.0f * CAVALRY_SPEED * 1.5f * FIXED_TIMESTEP,
+              "neighbour list skin too thin for one tick of movement");
+
+NeighbourLists::NeighbourLists(const SpatialHash& spatialHash, float interactionRadius, float skin)
+    : m_spatialHash(spatialHash), m_interactionRadius(interactionRadius), m_skin(skin) {}
+
+void NeighbourLists::refresh(entt::registry& registry) {
+    m_lastRebuildCount = 0;
+
+    auto soldierView = registry.view<Position, Team>(entt::exclude<Dead, Formation>);
+
+    // Size the table up front; rebuild() touches other soldiers' lists and
+    // must not have references invalidated under it
+    size_t maxIndex = 0;
+    for (auto entity : soldierView) {
+        maxIndex = std::max(maxIndex, static_cast<size_t>(entt::to_entity(entity)));
+    }
+    if (maxIndex >= m_lists.size()) {
+        m_lists.resize(maxIndex + 1);
+    }
+
+    const float rebuildDistSq = REBUILD_DISTANCE * REBUILD_DISTANCE;
+    for (auto entity : soldierView) {
+        const auto& pos = soldierView.get<Position>(entity);
+        List& list = m_lists[static_cast<size_t>(entt::to_entity(entity))];
+
+        if (list.owner == entity) {
+            float dx = pos.x - list.refX;
+            float dy = pos.y - list.refY;
+            if (dx * dx + dy * dy <= rebuildDistSq) continue;
+        }
+
+        rebuild(list, entity, pos.x, pos.y);
+        ++m_lastRebuildCount;
+    }
+}
+
+void NeighbourLists::clear() {
+    m_lists.clear();
+    m_lastRebuildCount = 0;
+}
+
+void NeighbourLists::rebuild(List& list, entt::entity entity, float x, float y) {
+    list.owner = entity;
+    list.refX = x;
+    list.refY = y;
+    list.neighbours.clear();
+
+    m_spatialHash.forEachInRadius(x, y, m_interactionRadius + m_skin, [&](const SpatialEntry& other) {
+        if (other.entity == entity) return;
+        list.neighbours.push_back(other.entity);
+
+        // Make sure the neighbour sees us too, even if its list is older
+        auto index = static_cast<size_t>(entt::to_entity(other.entity));
+        if (index >= m_lists.size()) return;
+        List& theirs = m_lists[index];
+        if (theirs.owner != other.entity) return;
+        if (std::find(theirs.neighbours.begin(), theirs.neighbours.end(), entity) == theirs.neighbours.end()) {
+            theirs.neighbours.push_back(entity);
+        }
+    });
+}
+
+} // namespace fob
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/constants.hpp"
+#include "components/components.hpp"
+#include "simulation/spatial_hash.hpp"
+#include <entt/entt.hpp>
+#include <vector>
+
+namespace fob {
+
+/// Cached per-soldier neighbour lists (Verlet lists) layered over a SpatialHash.
+///
+/// Each soldier keeps the entities that were within interaction radius + skin
+/// of it when its list was last built, and only rebuilds once it has drifted
+/// more than REBUILD_DISTANCE from where that happened. A soldier that
+/// rebuilds also adds itself to each new neighbour's list, so neighbours that
+/// haven't rebuilt still see it arrive. Soldiers holding a line barely move,
+/// so most ticks need no spatial queries at all.
+///
+/// Queries read current positions back from the SpatialHash and apply the
+/// exact radius test, so results match a direct hash query as long as the
+/// query circle lies within the interaction radius of the soldier. Soldiers
+/// without a list fall back to querying the hash.
+///
+/// Usage per tick: refresh() once the spatial hash is current, then query.
+class NeighbourLists {
+public:
+    /// Rebuild threshold. Two soldiers' lists can each be up to 2x this stale
+    /// relative to one another, plus one more for the soldier that rebuilt
+    /// last; the rest of the skin covers movement within the tick.
+    static constexpr float REBUILD_DISTANCE = NEIGHBOUR_LIST_SKIN * 0.2f;
+
+    explicit NeighbourLists(const SpatialHash& spatialHash,
+                            float interactionRadius = NEIGHBOUR_INTERACTION_RADIUS,
+                            float skin = NEIGHBOUR_LIST_SKIN);
+
+    /// Rebuild the lists of soldiers that have moved too far, and build lists
+    /// for soldiers that don't have one yet.
+    void refresh(entt::registry& registry);
+
+    /// Drop every list, e.g. when the battle is reset.
+    void clear();
+
+    /// Number of list rebuilds done by the last refresh().
+    size_t lastRebuildCount() const { return m_lastRebuildCount; }
+
+    /// Visit the neighbours of `entity` within radius of (x, y). Same callback
+    /// rules as SpatialHash::forEachInRadius; the entity itself is not visited.
+    template<typename Fn>
+    void forEachInRadius(entt::entity entity, float x, float y, float radius, Fn&& fn) const {
+        forEachFiltered(entity, x, y, radius, [](Team::Value) { return true; }, fn);
+    }
+
+    template<typename Fn>
+    void forEachEnemyInRadius(entt::entity entity, float x, float y, float radius,
+                              Team::Value team, Fn&& fn) const {
+        forEachFiltered(entity, x, y, radius, [team](Team::Value other) { return other != team; }, fn);
+    }
+
+    template<typename Fn>
+    void forEachAllyInRadius(entt::entity entity, float x, float y, float radius,
+                             Team::Value team, Fn&& fn) const {
+        forEachFiltered(entity, x, y, radius, [team](Team::Value other) { return other == team; }, fn);
+    }
+
+private:
+    struct List {
+        entt::entity owner = entt::null;  // soldier the list belongs to, for recycled indices
+        float refX = 0.0f;                // position the list was built at
+        float refY = 0.0f;
+        std::vector<entt::entity> neighbours;
+    };
+
+    const List* findList(entt::entity entity) const {
+        auto index = static_cast<size_t>(entt::to_entity(entity));
+        if (index >= m_lists.size() || m_lists[index].owner != entity) return nullptr;
+        return &m_lists[index];
+    }
+
+    void rebuild(List& list, entt::entity entity, float x, float y);
+
+    template<typename Accept, typename Fn>
+    void forEachFiltered(entt::entity entity, float x, float y, float radius,
+                         Accept accept, Fn& fn) const {
+        const List* list = findList(entity);
+        if (!list) {
+            m_spatialHash.forEachInRadius(x, y, radius, [&](const SpatialEntry& other, float distSq) {
+                if (other.entity == entity || !accept(other.team)) return true;
+                return visitSpatialEntry(fn, other, distSq);
+            });
+            return;
+        }
+
+        const float radiusSq = radius * radius;
+        for (entt::entity neighbour : list->neighbours) {
+            const SpatialEntry* other = m_spatialHash.find(neighbour);
+            if (!other || !accept(other->team)) continue;
+
+            float dx = other->x - x;
+            float dy = other->y - y;
+            float distSq = dx * dx + dy * dy;
+            if (distSq > radiusSq) continue;
+            if (!visitSpatialEntry(fn, *other, distSq)) return;
+        }
+    }
+
+    const SpatialHash& m_spatialHash;
+    float m_interactionRadius;
+    float m_skin;
+    size_t m_lastRebuildCount = 0;
+
+    // Entity index -> list
+    std::vector<List> m_lists;
+};
+
+} // namespace fob
@@ -0,0 +1,255 @@
+#include "simulation/separation_kernel.hpp"
+#include "core/constants.hpp"
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define FOB_SEPARATION_X86 1
+#include <immintrin.h>
+#endif
+
+namespace fob {
+
+namespace {
+
+constexpr float MIN_SEPARATION_DIST = 0.01f;
+constexpr float ENEMY_WEIGHT = 2.0f;
+
+/// Reference implementation, also used for the tails of the SIMD paths.
+void accumulateScalar(float x, float y, int32_t team,
+                      const float* nx, const float* ny, const int32_t* nteam,
+                      size_t begin, size_t end, SeparationForces& out) {
+    for (size_t i = begin; i < end; ++i) {
+        float dx = x - nx[i];
+        float dy = y - ny[i];
+        float dist = std::sqrt(dx * dx + dy * dy);
+        if (dist < MIN_SEPARATION_DIST) continue;
+
+        float awayX = dx / dist;
+        float awayY = dy / dist;
+
+        if (nteam[i] != team) {
+            if (dist < ENEMY_STOP_RADIUS) {
+                out.enemyContact = true;
+                float strength = (ENEMY_STOP_RADIUS - dist) / ENEMY_STOP_RADIUS;
+                out.enemyX += awayX * strength * ENEMY_WEIGHT;
+                out.enemyY += awayY * strength * ENEMY_WEIGHT;
+            }
+        } else {
+            if (dist < ALLY_SEPARATION_RADIUS) {
+                float strength = (ALLY_SEPARATION_RADIUS - dist) / ALLY_SEPARATION_RADIUS;
+                out.allyX += awayX * strength;
+                out.allyY += awayY * strength;
+            }
+        }
+    }
+}
+
+SeparationForces separationScalar(float x, float y, int32_t team,
+                                  const float* nx, const float* ny, const int32_t* nteam,
+                                  size_t count) {
+    SeparationForces out;
+    accumulateScalar(x, y, team, nx, ny, nteam, 0, count, out);
+    return out;
+}
+
+#ifdef FOB_SEPARATION_X86
+
+float horizontalSum(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+// Per lane: the same terms as accumulateScalar, with the team branch and
+// range tests turned into masks
+SeparationForces separationSSE2(float x, float y, int32_t team,
+                                const float* nx, const float* ny, const int32_t* nteam,
+                                size_t count) {
+    const __m128 px = _mm_set1_ps(x);
+    const __m128 py = _mm_set1_ps(y);
+    const __m128i myTeam = _mm_set1_epi32(team);
+    const __m128 minDist = _mm_set1_ps(MIN_SEPARATION_DIST);
+    const __m128 enemyRadius = _mm_set1_ps(ENEMY_STOP_RADIUS);
+    const __m128 allyRadius = _mm_set1_ps(ALLY_SEPARATION_RADIUS);
+    const __m128 enemyWeight = _mm_set1_ps(ENEMY_WEIGHT);
+
+    __m128 enemyX = _mm_setzero_ps();
+    __m128 enemyY = _mm_setzero_ps();
+    __m128 allyX = _mm_setzero_ps();
+    __m128 allyY = _mm_setzero_ps();
+    int contact = 0;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(nx + i));
+        __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(ny + i));
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 valid = _mm_cmpge_ps(dist, minDist);
+        __m128 awayX = _mm_div_ps(dx, dist);
+        __m128 awayY = _mm_div_ps(dy, dist);
+
+        __m128 ally = _mm_castsi128_ps(
+            _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nteam + i)), myTeam));
+
+        __m128 enemyIn = _mm_andnot_ps(ally, _mm_and_ps(valid, _mm_cmplt_ps(dist, enemyRadius)));
+        __m128 allyIn = _mm_and_ps(ally, _mm_and_ps(valid, _mm_cmplt_ps(dist, allyRadius)));
+        contact |= _mm_movemask_ps(enemyIn);
+
+        __m128 enemyStrength = _mm_mul_ps(
+            _mm_div_ps(_mm_sub_ps(enemyRadius, dist), enemyRadius), enemyWeight);
+        __m128 allyStrength = _mm_div_ps(_mm_sub_ps(allyRadius, dist), allyRadius);
+
+        enemyX = _mm_add_ps(enemyX, _mm_and_ps(enemyIn, _mm_mul_ps(awayX, enemyStrength)));
+        enemyY = _mm_add_ps(enemyY, _mm_and_ps(enemyIn, _mm_mul_ps(awayY, enemyStrength)));
+        allyX = _mm_add_ps(allyX, _mm_and_ps(allyIn, _mm_mul_ps(awayX, allyStrength)));
+        allyY = _mm_add_ps(allyY, _mm_and_ps(allyIn, _mm_mul_ps(awayY, allyStrength)));
+    }
+
+    SeparationForces out;
+    out.enemyX = horizontalSum(enemyX);
+    out.enemyY = horizontalSum(enemyY);
+    out.allyX = horizontalSum(allyX);
+    out.allyY = horizontalSum(allyY);
+    out.enemyContact = contact != 0;
+    accumulateScalar(x, y, team, nx, ny, nteam, i, count, out);
+    return out;
+}
+
+__attribute__((target("avx2")))
+float horizontalSum256(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuf = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(sum, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+__attribute__((target("avx2")))
+SeparationForces separationAVX2(float x, float y, int32_t team,
+                                const float* nx, const float* ny, const int32_t* nteam,
+                                size_t count) {
+    const __m256 px = _mm256_set1_ps(x);
+    const __m256 py = _mm256_set1_ps(y);
+    const __m256i myTeam = _mm256_set1_epi32(team);
+    const __m256 minDist = _mm256_set1_ps(MIN_SEPARATION_DIST);
+    const __m256 enemyRadius = _mm256_set1_ps(ENEMY_STOP_RADIUS);
+    const __m256 allyRadius = _mm256_set1_ps(ALLY_SEPARATION_RADIUS);
+    const __m256 enemyWeight = _mm256_set1_ps(ENEMY_WEIGHT);
+
+    __m256 enemyX = _mm256_setzero_ps();
+    __m256 enemyY = _mm256_setzero_ps();
+    __m256 allyX = _mm256_setzero_ps();
+    __m256 allyY = _mm256_setzero_ps();
+    int contact = 0;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(px, _mm256_loadu_ps(nx + i));
+        __m256 dy = _mm256_sub_ps(py, _mm256_loadu_ps(ny + i));
+        // Separate mul/add rather than FMA, to round like the scalar path
+        __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 valid = _mm256_cmp_ps(dist, minDist, _CMP_GE_OQ);
+        __m256 awayX = _mm256_div_ps(dx, dist);
+        __m256 awayY = _mm256_div_ps(dy, dist);
+
+        __m256 ally = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nteam + i)), myTeam));
+
+        __m256 enemyIn = _mm256_andnot_ps(
+            ally, _mm256_and_ps(valid, _mm256_cmp_ps(dist, enemyRadius, _CMP_LT_OQ)));
+        __m256 allyIn = _mm256_and_ps(
+            ally, _mm256_and_ps(valid, _mm256_cmp_ps(dist, allyRadius, _CMP_LT_OQ)));
+        contact |= _mm256_movemask_ps(enemyIn);
+
+        __m256 enemyStrength = _mm256_mul_ps(
+            _mm256_div_ps(_mm256_sub_ps(enemyRadius, dist), enemyRadius), enemyWeight);
+        __m256 allyStrength = _mm256_div_ps(_mm256_sub_ps(allyRadius, dist), allyRadius);
+
+        enemyX = _mm256_add_ps(enemyX, _mm256_and_ps(enemyIn, _mm256_mul_ps(awayX, enemyStrength)));
+        enemyY = _mm256_add_ps(enemyY, _mm256_and_ps(enemyIn, _mm256_mul_ps(awayY, enemyStrength)));
+        allyX = _mm256_add_ps(allyX, _mm256_and_ps(allyIn, _mm256_mul_ps(awayX, allyStrength)));
+        allyY = _mm256_add_ps(allyY, _mm256_and_ps(allyIn, _mm256_mul_ps(awayY, allyStrength)));
+    }
+
+    SeparationForces out;
+    out.enemyX = horizontalSum256(enemyX);
+    out.enemyY = horizontalSum256(enemyY);
+    out.allyX = horizontalSum256(allyX);
+    out.allyY = horizontalSum256(allyY);
+    out.enemyContact = contact != 0;
+    accumulateScalar(x, y, team, nx, ny, nteam, i, count, out);
+    return out;
+}
+
+#endif // FOB_SEPARATION_X86
+
+bool hostSupports(SimdPath path) {
+    switch (path) {
+        case SimdPath::Scalar:
+            return true;
+#ifdef FOB_SEPARATION_X86
+        case SimdPath::SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case SimdPath::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+        default:
+            return false;
+#endif
+    }
+    return false;
+}
+
+SimdPath detectSimdPath() {
+    if (hostSupports(SimdPath::AVX2)) return SimdPath::AVX2;
+    if (hostSupports(SimdPath::SSE2)) return SimdPath::SSE2;
+    return SimdPath::Scalar;
+}
+
+using SeparationFn = SeparationForces (*)(float, float, int32_t,
+                                          const float*, const float*, const int32_t*, size_t);
+
+/// Kernel for a path, stepping down to what the host can actually run.
+SeparationFn kernelFor(SimdPath path) {
+#ifdef FOB_SEPARATION_X86
+    if (path == SimdPath::AVX2 && hostSupports(SimdPath::AVX2)) return separationAVX2;
+    if (path != SimdPath::Scalar && hostSupports(SimdPath::SSE2)) return separationSSE2;
+#else
+    (void)path;
+#endif
+    return separationScalar;
+}
+
+} // anonymous namespace
+
+SimdPath separationSimdPath() {
+    static const SimdPath path = detectSimdPath();
+    return path;
+}
+
+SeparationForces computeSeparation(float x, float y, int32_t team,
+                                   const float* nx, const float* ny, const int32_t* nteam,
+                                   size_t count) {
+    static const SeparationFn kernel = kernelFor(separationSimdPath());
+    return kernel(x, y, team, nx, ny, nteam, count);
+}
+
+SeparationForces computeSeparationOn(SimdPath path, float x, float y, int32_t team,
+                                     const float* nx, const float* ny, const int32_t* nteam,
+                                     size_t count) {
+    return kernelFor(path)(x, y, team, nx, ny, nteam, count);
+}
+
+const char* simdPathName(SimdPath path) {
+    switch (path) {
+        case SimdPath::Scalar: return "scalar";
+        case SimdPath::SSE2:   return "sse2";
+        case SimdPath::AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace fob
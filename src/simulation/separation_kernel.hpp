@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fob {
+
+/// Repulsion sums for one soldier: raw (unnormalised) enemy and ally push
+/// vectors, and whether any enemy is inside ENEMY_STOP_RADIUS.
+struct SeparationForces {
+    float enemyX = 0.0f;
+    float enemyY = 0.0f;
+    float allyX = 0.0f;
+    float allyY = 0.0f;
+    bool enemyContact = false;
+};
+
+/// Instruction set a kernel runs on, narrowest first.
+enum class SimdPath : uint8_t { Scalar, SSE2, AVX2 };
+
+/// Separation forces on a soldier at (x, y) of team `team` from `count`
+/// packed neighbours (nx[i], ny[i], nteam[i]). Neighbours closer than 0.01
+/// are ignored; enemies push within ENEMY_STOP_RADIUS, allies within
+/// ALLY_SEPARATION_RADIUS, both falling off linearly with distance.
+///
+/// Dispatches once, at first use, to the widest path the host CPU supports.
+/// Every path computes each neighbour's term with IEEE sqrt and division, so
+/// the only difference from the scalar path is summation order: components
+/// agree to within 1e-5 relative to the summed magnitudes, and the contact
+/// flag is identical. FaceOfBattleBench checks both, and the dispatch.
+SeparationForces computeSeparation(float x, float y, int32_t team,
+                                   const float* nx, const float* ny, const int32_t* nteam,
+                                   size_t count);
+
+/// As computeSeparation on an explicit path; paths the host can't run fall
+/// back to scalar. For comparing paths and benchmarking.
+SeparationForces computeSeparationOn(SimdPath path, float x, float y, int32_t team,
+                                     const float* nx, const float* ny, const int32_t* nteam,
+                                     size_t count);
+
+/// The path computeSeparation dispatches to on this host.
+SimdPath separationSimdPath();
+
+const char* simdPathName(SimdPath path);
+
+} // namespace fob
@@ -0,0 +1,79 @@
+#include "simulation/simulation.hpp"
+#include "components/components.hpp"
+#include "core/constants.hpp"
+
+namespace fob {
+
+Simulation::Simulation(entt::registry& registry, SpatialHash::Backend spatialBackend,
+                       uint64_t seed, unsigned threadCount)
+    : m_registry(registry)
+    , m_seed(seed)
+    , m_jobs(threadCount)
+    , m_events(m_jobs)
+    , m_spatialIndex(spatialBackend)
+    , m_neighbours(m_spatialIndex.fine())
+    , m_combatSystem(seed, m_flashSystem, m_events) {
+    // Registered in tick order; the scheduler only keeps the ordering
+    // between systems whose access conflicts
+
+    m_scheduler.add("spatial-index",
+        SystemAccess().read<Position, Team, Dead, Formation, Routing>()
+                      .writeResource<SpatialHierarchy>(),
+        [this] { syncSpatialIndex(); });
+
+    m_scheduler.add("neighbour-lists",
+        SystemAccess().read<Position, Team, Dead, Formation>()
+                      .readResource<SpatialHierarchy>()
+                      .writeResource<NeighbourLists>(),
+        [this] { m_neighbours.refresh(m_registry); });
+
+    m_scheduler.add("flash",
+        SystemAccess().write<FlashEffect>()
+                      .writeResource<FlashSystem>(),
+        [this] { m_flashSystem.update(m_registry, m_tick); });
+
+    m_scheduler.add("formation",
+        SystemAccess().read<Team, Routing, MovementTarget, Dead>()
+                      .write<Position, Formation, FormationMember>()
+                      .readResource<SpatialHierarchy, NeighbourLists>(),
+        [this] { m_formationSystem.update(m_registry, m_neighbours, m_events, FIXED_TIMESTEP); });
+
+    m_scheduler.add("movement",
+        SystemAccess().read<Team, UnitType, MovementTarget, Dead, CombatState, Routing>()
+                      .write<Position, Velocity, Formation, FormationMember>()
+                      .readResource<NeighbourLists>()
+                      .writeResource<SpatialHierarchy>(),
+        [this] {
+            m_movementSystem.update(m_registry, m_spatialIndex, m_neighbours, m_jobs, FIXED_TIMESTEP);
+        });
+
+    m_scheduler.add("combat",
+        SystemAccess().read<Position, Team, Formation, FormationMember>()
+                      .write<Stats, CombatState, FlashEffect, Dead, Routing, Pursuing>()
+                      .readResource<NeighbourLists>()
+                      .writeResource<SpatialHierarchy, FlashSystem>(),
+        [this] {
+            m_combatSystem.update(m_registry, m_spatialIndex, m_neighbours, m_jobs, m_tick);
+        });
+}
+
+void Simulation::tick() {
+    ++m_tick;
+    m_scheduler.run(m_registry, m_jobs);
+    m_events.flip();
+}
+
+void Simulation::syncSpatialIndex() {
+    if (m_spatialIndex.incremental() && m_spatialIndex.size() > 0) return;
+
+    m_spatialIndex.clear();
+    auto posView = m_registry.view<Position, Team>(entt::exclude<Dead, Formation>);
+    for (auto entity : posView) {
+        const auto& pos = posView.get<Position>(entity);
+        m_spatialIndex.insert(entity, pos.x, pos.y, posView.get<Team>(entity).value,
+                              m_registry.all_of<Routing>(entity));
+    }
+    m_spatialIndex.build(m_jobs);
+}
+
+} // namespace fob
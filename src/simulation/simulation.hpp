@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/job_system.hpp"
+#include "core/system_scheduler.hpp"
+#include "simulation/spatial_hierarchy.hpp"
+#include "simulation/neighbour_lists.hpp"
+#include "simulation/events.hpp"
+#include "systems/formation_system.hpp"
+#include "systems/movement_system.hpp"
+#include "systems/combat_system.hpp"
+#include "systems/flash_system.hpp"
+#include <entt/entt.hpp>
+
+namespace fob {
+
+/// The fixed-step battle simulation: the spatial index, neighbour lists,
+/// gameplay systems and the scheduler that runs them over a registry.
+///
+/// Each system is registered with the components and shared state it reads
+/// and writes; tick() runs them as a dependency graph, so systems that don't
+/// conflict share the tick. To add a system, register it in the constructor
+/// at the point in the tick order where it belongs.
+///
+/// Systems report what happened (hits, deaths, routs) on the EventBus; each
+/// tick's events become readable once the tick ends, to consumers in the
+/// next tick and to callers between ticks.
+class Simulation {
+public:
+    /// @param registry The ECS registry to simulate; must outlive this
+    /// @param spatialBackend Storage backend for both spatial index levels
+    /// @param seed Seed for every random roll; the same seed and setup
+    ///        replay the same battle
+    /// @param threadCount Threads for the JobSystem, 0 for one per hardware thread
+    Simulation(entt::registry& registry, SpatialHash::Backend spatialBackend,
+               uint64_t seed, unsigned threadCount = 0);
+
+    /// Advance the simulation by one FIXED_TIMESTEP.
+    void tick();
+
+    uint64_t seed() const { return m_seed; }
+    /// Ticks run so far; the tick being run while inside tick().
+    uint32_t currentTick() const { return m_tick; }
+    JobSystem& jobs() { return m_jobs; }
+    /// Events from the last completed tick.
+    const EventBus& events() const { return m_events; }
+    const SystemScheduler& scheduler() const { return m_scheduler; }
+    const SpatialHierarchy& spatialIndex() const { return m_spatialIndex; }
+
+private:
+    /// Bring the spatial index up to date for this tick. Rebuild backends are
+    /// refilled from scratch; the incremental backend is kept current by the
+    /// systems themselves (MovementSystem moves, CombatSystem removes the
+    /// dead) and only needs populating once.
+    void syncSpatialIndex();
+
+    entt::registry& m_registry;
+    uint64_t m_seed;
+    uint32_t m_tick = 0;
+    JobSystem m_jobs;
+    EventBus m_events;
+    SpatialHierarchy m_spatialIndex;
+    NeighbourLists m_neighbours;
+
+    FlashSystem m_flashSystem;
+    FormationSystem m_formationSystem;
+    MovementSystem m_movementSystem;
+    CombatSystem m_combatSystem;
+
+    SystemScheduler m_scheduler;
+};
+
+} // namespace fob
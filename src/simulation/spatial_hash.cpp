@@ -0,0 +1,477 @@
+#include "simulation/spatial_hash.hpp"
+#include "core/job_system.hpp"
+
+namespace fob {
+
+namespace {
+
+// Records each thread of a parallel build needs to win back its share of
+// the fork/join and per-row scratch; below two threads' worth (the shipped
+// battles are far smaller) the serial counting sort is used
+constexpr size_t PARALLEL_BUILD_RECORDS_PER_THREAD = 8192;
+
+// Start of the t-th of `parts` near-equal slices of [0, n)
+size_t sliceBegin(size_t n, unsigned t, unsigned parts) {
+    return n * t / parts;
+}
+
+} // anonymous namespace
+
+SpatialHash::SpatialHash(float cellSize, Backend backend, GridBounds bounds)
+    : m_cellSize(cellSize), m_invCellSize(1.0f / cellSize),
+      m_backend(backend), m_bounds(bounds) {
+    m_gridWidth = std::max(1, static_cast<int>(std::ceil((bounds.maxX - bounds.minX) * m_invCellSize)));
+    m_gridHeight = std::max(1, static_cast<int>(std::ceil((bounds.maxY - bounds.minY) * m_invCellSize)));
+
+    if (m_backend == Backend::Incremental) {
+        m_gridCells.resize(bucketCount());
+    }
+}
+
+void SpatialHash::enableAggregates() {
+    m_trackAggregates = true;
+    if (m_backend != Backend::Hashed) {
+        m_aggregates.assign(bucketCount(), SpatialAggregate{});
+    }
+}
+
+void SpatialHash::clear() {
+    m_cells.clear();
+    m_pending.clear();
+    for (auto& cell : m_gridCells) {
+        cell.clear();
+    }
+    if (m_trackAggregates) {
+        m_hashedAggregates.clear();
+        std::fill(m_aggregates.begin(), m_aggregates.end(), SpatialAggregate{});
+    }
+    std::fill(m_slots.begin(), m_slots.end(), Slot{});
+    m_size = 0;
+}
+
+void SpatialHash::insert(entt::entity entity, float x, float y, Team::Value team, bool routing) {
+    const SpatialEntry entry{entity, x, y, team, routing};
+    switch (m_backend) {
+        case Backend::Hashed: {
+            int64_t key = cellKey(x, y);
+            auto& part = m_cells[key][team];
+            part.push_back(entry);
+            Slot& slot = slotFor(entity);
+            slot = {key, static_cast<uint32_t>(part.size() - 1), team};
+            if (auto* aggregate = aggregateFor(slot)) aggregate->add(entry);
+            break;
+        }
+
+        case Backend::FlatGrid:
+            // Slot and aggregates are filled in when build() places the record
+            m_pending.push_back(entry);
+            break;
+
+        case Backend::Incremental: {
+            remove(entity);  // re-inserting replaces the old record
+            uint32_t bucket = gridBucket(x, y, team);
+            auto& part = m_gridCells[bucket];
+            part.push_back(entry);
+            Slot& slot = slotFor(entity);
+            slot = {bucket, static_cast<uint32_t>(part.size() - 1), team};
+            if (auto* aggregate = aggregateFor(slot)) aggregate->add(entry);
+            break;
+        }
+    }
+    ++m_size;
+}
+
+void SpatialHash::build() {
+    if (m_backend != Backend::FlatGrid) return;
+
+    const size_t buckets = bucketCount();
+    m_cellStart.assign(buckets + 1, 0);
+    m_pendingCell.resize(m_pending.size());
+
+    // Pass 1: histogram of records per (cell, team) bucket
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        const auto& entry = m_pending[i];
+        uint32_t bucket = gridBucket(entry.x, entry.y, entry.team);
+        m_pendingCell[i] = bucket;
+        ++m_cellStart[bucket + 1];
+    }
+
+    // Exclusive prefix sum turns counts into start offsets
+    for (size_t b = 0; b < buckets; ++b) {
+        m_cellStart[b + 1] += m_cellStart[b];
+    }
+
+    // Pass 2: scatter, preserving insertion order within each bucket
+    m_cellCursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_entries.resize(m_pending.size());
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        uint32_t bucket = m_pendingCell[i];
+        uint32_t dst = m_cellCursor[bucket]++;
+        m_entries[dst] = m_pending[i];
+        slotFor(m_pending[i].entity) = {bucket, dst, m_pending[i].team};
+    }
+
+    if (m_trackAggregates) {
+        accumulateBuckets(0, buckets);
+    }
+}
+
+void SpatialHash::build(JobSystem& jobs) {
+    if (m_backend != Backend::FlatGrid) return;
+
+    // Only fan out to as many threads as the input can keep busy
+    const size_t count = m_pending.size();
+    const unsigned threads = static_cast<unsigned>(
+        std::min<size_t>(jobs.threadCount(), count / PARALLEL_BUILD_RECORDS_PER_THREAD));
+    if (threads < 2) {
+        build();
+        return;
+    }
+
+    // Buckets are row-major, so a band of grid rows is a contiguous bucket
+    // range. Records are first split into one band per thread, then each
+    // thread counting-sorts its own band. Scratch is threads x rows and
+    // threads x threads, never threads x buckets.
+    const size_t rows = static_cast<size_t>(m_gridHeight);
+    const size_t bucketsPerRow = static_cast<size_t>(m_gridWidth) * Team::COUNT;
+    const size_t buckets = bucketCount();
+    m_threadRowCounts.resize(threads * rows);
+    m_threadSlotCount.resize(threads);
+    m_rowBand.resize(rows);
+    m_bandRowStart.resize(threads + 1);
+    m_bandStart.resize(threads + 1);
+    m_bandHeads.resize(threads * threads);
+    m_pendingCell.resize(count);
+    m_banded.resize(count);
+    m_cellCursor.resize(buckets);
+    m_cellStart.resize(buckets + 1);
+    m_entries.resize(count);
+
+    // Pass 1: each thread buckets its own contiguous slice of the inserts and
+    // counts them per row
+    jobs.run(threads, [&](unsigned t) {
+        uint32_t* rowCounts = &m_threadRowCounts[t * rows];
+        std::fill(rowCounts, rowCounts + rows, 0u);
+        size_t slotCount = 0;
+        for (size_t i = sliceBegin(count, t, threads); i < sliceBegin(count, t + 1, threads); ++i) {
+            const auto& entry = m_pending[i];
+            uint32_t bucket = gridBucket(entry.x, entry.y, entry.team);
+            m_pendingCell[i] = bucket;
+            ++rowCounts[bucket / bucketsPerRow];
+            slotCount = std::max(slotCount, static_cast<size_t>(entt::to_entity(entry.entity)) + 1);
+        }
+        m_threadSlotCount[t] = slotCount;
+    });
+
+    // Cut the rows into one band per thread, balancing records plus the
+    // per-bucket work of sorting (and aggregating) each row
+    size_t totalWork = count + rows * bucketsPerRow;
+    size_t work = 0;
+    unsigned band = 0;
+    m_bandRowStart[0] = 0;
+    for (size_t r = 0; r < rows; ++r) {
+        while (band + 1 < threads && work >= sliceBegin(totalWork, band + 1, threads)) {
+            m_bandRowStart[++band] = static_cast<uint32_t>(r);
+        }
+        m_rowBand[r] = band;
+        for (unsigned t = 0; t < threads; ++t) {
+            work += m_threadRowCounts[t * rows + r];
+        }
+        work += bucketsPerRow;
+    }
+    while (band + 1 <= threads) {
+        m_bandRowStart[++band] = static_cast<uint32_t>(rows);
+    }
+
+    // Where each thread's records for each band go: bands in order, and
+    // within a band, earlier slices first
+    std::fill(m_bandHeads.begin(), m_bandHeads.end(), 0u);
+    for (unsigned t = 0; t < threads; ++t) {
+        for (size_t r = 0; r < rows; ++r) {
+            m_bandHeads[t * threads + m_rowBand[r]] += m_threadRowCounts[t * rows + r];
+        }
+    }
+    uint32_t offset = 0;
+    for (unsigned b = 0; b < threads; ++b) {
+        m_bandStart[b] = offset;
+        for (unsigned t = 0; t < threads; ++t) {
+            uint32_t n = m_bandHeads[t * threads + b];
+            m_bandHeads[t * threads + b] = offset;
+            offset += n;
+        }
+    }
+    m_bandStart[threads] = offset;
+    m_cellStart[buckets] = offset;
+
+    // Grow the slot table up front so the scatter never reallocates it
+    size_t slotCount = *std::max_element(m_threadSlotCount.begin(), m_threadSlotCount.end());
+    if (slotCount > m_slots.size()) {
+        m_slots.resize(slotCount);
+    }
+
+    // Pass 2: each thread deals its slice out to the bands, so every band
+    // holds its records in insertion order
+    jobs.run(threads, [&](unsigned t) {
+        uint32_t* heads = &m_bandHeads[t * threads];
+        for (size_t i = sliceBegin(count, t, threads); i < sliceBegin(count, t + 1, threads); ++i) {
+            uint32_t band = m_rowBand[m_pendingCell[i] / bucketsPerRow];
+            m_banded[heads[band]++] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Pass 3: each thread counting-sorts one band into its own bucket range.
+    // Stable within the band, which reproduces the serial build exactly
+    jobs.run(threads, [&](unsigned b) {
+        const size_t beginBucket = m_bandRowStart[b] * bucketsPerRow;
+        const size_t endBucket = m_bandRowStart[b + 1] * bucketsPerRow;
+        const uint32_t* begin = m_banded.data() + m_bandStart[b];
+        const uint32_t* end = m_banded.data() + m_bandStart[b + 1];
+
+        std::fill(m_cellCursor.begin() + beginBucket, m_cellCursor.begin() + endBucket, 0u);
+        for (const uint32_t* i = begin; i != end; ++i) {
+            ++m_cellCursor[m_pendingCell[*i]];
+        }
+
+        uint32_t cell = m_bandStart[b];
+        for (size_t bucket = beginBucket; bucket < endBucket; ++bucket) {
+            uint32_t n = m_cellCursor[bucket];
+            m_cellStart[bucket] = cell;
+            m_cellCursor[bucket] = cell;
+            cell += n;
+        }
+
+        for (const uint32_t* i = begin; i != end; ++i) {
+            uint32_t bucket = m_pendingCell[*i];
+            uint32_t dst = m_cellCursor[bucket]++;
+            m_entries[dst] = m_pending[*i];
+            m_slots[entt::to_entity(m_pending[*i].entity)] = {bucket, dst, m_pending[*i].team};
+        }
+
+        if (m_trackAggregates) {
+            accumulateBuckets(beginBucket, endBucket);
+        }
+    });
+}
+
+void SpatialHash::accumulateBuckets(size_t beginBucket, size_t endBucket) {
+    for (size_t b = beginBucket; b < endBucket; ++b) {
+        SpatialAggregate aggregate;
+        for (uint32_t i = m_cellStart[b]; i < m_cellStart[b + 1]; ++i) {
+            aggregate.add(m_entries[i]);
+        }
+        m_aggregates[b] = aggregate;
+    }
+}
+
+void SpatialHash::move(entt::entity entity, float x, float y) {
+    Slot* slot = findSlot(entity);
+    if (!slot) return;
+
+    if (m_backend != Backend::Incremental) {
+        // Rewrite the record where it is; the next build re-buckets it
+        auto* entry = const_cast<SpatialEntry*>(entryAt(*slot));
+        if (!entry) return;
+        if (auto* aggregate = aggregateFor(*slot)) {
+            aggregate->sumX += x - entry->x;
+            aggregate->sumY += y - entry->y;
+        }
+        entry->x = x;
+        entry->y = y;
+        return;
+    }
+
+    uint32_t newBucket = gridBucket(x, y, slot->team);
+    if (newBucket == slot->cell) {
+        // Common case: still in the same cell, just refresh the record
+        auto& entry = m_gridCells[newBucket][slot->index];
+        if (auto* aggregate = aggregateFor(*slot)) {
+            aggregate->sumX += x - entry.x;
+            aggregate->sumY += y - entry.y;
+        }
+        entry.x = x;
+        entry.y = y;
+        return;
+    }
+
+    SpatialEntry entry = m_gridCells[slot->cell][slot->index];
+    if (auto* aggregate = aggregateFor(*slot)) aggregate->subtract(entry);
+    entry.x = x;
+    entry.y = y;
+    unlinkGridCell(*slot);
+
+    auto& part = m_gridCells[newBucket];
+    part.push_back(entry);
+    *slot = {newBucket, static_cast<uint32_t>(part.size() - 1), entry.team};
+    if (auto* aggregate = aggregateFor(*slot)) aggregate->add(entry);
+}
+
+void SpatialHash::remove(entt::entity entity) {
+    Slot* slot = findSlot(entity);
+    if (!slot) return;
+
+    if (auto* aggregate = aggregateFor(*slot)) {
+        aggregate->subtract(*entryAt(*slot));
+    }
+
+    switch (m_backend) {
+        case Backend::Hashed:
+            // Tombstone; the cell is rebuilt next tick anyway
+            m_cells[slot->cell][slot->team][slot->index].entity = entt::null;
+            break;
+        case Backend::FlatGrid:
+            m_entries[slot->index].entity = entt::null;
+            break;
+        case Backend::Incremental:
+            unlinkGridCell(*slot);
+            break;
+    }
+    *slot = Slot{};
+    --m_size;
+}
+
+void SpatialHash::setRouting(entt::entity entity, bool routing) {
+    Slot* slot = findSlot(entity);
+    if (!slot) return;
+
+    // entryAt() is const only so find() can share it; the record is ours
+    auto* entry = const_cast<SpatialEntry*>(entryAt(*slot));
+    if (!entry || entry->routing == routing) return;
+
+    if (auto* aggregate = aggregateFor(*slot)) {
+        if (routing) {
+            ++aggregate->routing;
+        } else {
+            --aggregate->routing;
+        }
+    }
+    entry->routing = routing;
+}
+
+const SpatialEntry* SpatialHash::find(entt::entity entity) const {
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    if (index >= m_slots.size() || m_slots[index].cell == Slot::NONE) return nullptr;
+
+    const SpatialEntry* entry = entryAt(m_slots[index]);
+    // Slots are keyed by entity index only, so reject a recycled handle
+    return entry && entry->entity == entity ? entry : nullptr;
+}
+
+SpatialAggregate SpatialHash::aggregateInRadius(float x, float y, float radius, Team::Value team) const {
+    return aggregateMasked(x, y, radius, allyMask(team));
+}
+
+SpatialAggregate SpatialHash::aggregateEnemiesInRadius(float x, float y, float radius,
+                                                       Team::Value team) const {
+    return aggregateMasked(x, y, radius, enemyMask(team));
+}
+
+SpatialAggregate SpatialHash::aggregateMasked(float x, float y, float radius, TeamMask teams) const {
+    SpatialAggregate total;
+    if (m_backend == Backend::FlatGrid && m_cellStart.empty()) return total;  // not built yet
+
+    const float radiusSq = radius * radius;
+    auto scanRecords = [&](const SpatialEntry* begin, const SpatialEntry* end) {
+        for (auto* e = begin; e != end; ++e) {
+            float dx = e->x - x;
+            float dy = e->y - y;
+            if (dx * dx + dy * dy > radiusSq || e->entity == entt::null) continue;
+            total.add(*e);
+        }
+        return true;
+    };
+
+    if (!m_trackAggregates) {
+        forEachCell(x - radius, y - radius, x + radius, y + radius, teams, scanRecords);
+        return total;
+    }
+
+    const bool bounded = m_backend != Backend::Hashed;
+    const float originX = bounded ? m_bounds.minX : 0.0f;
+    const float originY = bounded ? m_bounds.minY : 0.0f;
+    const CellRange range = cellRange(x - radius, y - radius, x + radius, y + radius);
+
+    for (int cy = range.minY; cy <= range.maxY; ++cy) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            // A cell is wholly inside the circle if its farthest corner is
+            float cellMinX = originX + cx * m_cellSize;
+            float cellMinY = originY + cy * m_cellSize;
+            float farX = std::max(x - cellMinX, cellMinX + m_cellSize - x);
+            float farY = std::max(y - cellMinY, cellMinY + m_cellSize - y);
+            bool inside = farX * farX + farY * farY <= radiusSq;
+
+            // Border cells of a bounded grid also hold clamped records from
+            // outside it, so their totals can't be trusted geometrically
+            if (bounded && (cx == 0 || cy == 0 || cx == m_gridWidth - 1 || cy == m_gridHeight - 1)) {
+                inside = false;
+            }
+
+            if (!inside) {
+                visitCell(cx, cy, teams, scanRecords);
+                continue;
+            }
+
+            if (bounded) {
+                uint32_t bucket = gridIndex(cx, cy) * Team::COUNT;
+                for (int t = 0; t < Team::COUNT; ++t) {
+                    if (teams & (1u << t)) total.merge(m_aggregates[bucket + t]);
+                }
+            } else {
+                auto it = m_hashedAggregates.find(packKey(cx, cy));
+                if (it == m_hashedAggregates.end()) continue;
+                for (int t = 0; t < Team::COUNT; ++t) {
+                    if (teams & (1u << t)) total.merge(it->second[t]);
+                }
+            }
+        }
+    }
+    return total;
+}
+
+SpatialHash::Slot* SpatialHash::findSlot(entt::entity entity) {
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    if (index >= m_slots.size() || m_slots[index].cell == Slot::NONE) return nullptr;
+    return &m_slots[index];
+}
+
+SpatialHash::Slot& SpatialHash::slotFor(entt::entity entity) {
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    if (index >= m_slots.size()) {
+        m_slots.resize(index + 1);
+    }
+    return m_slots[index];
+}
+
+const SpatialEntry* SpatialHash::entryAt(const Slot& slot) const {
+    switch (m_backend) {
+        case Backend::Hashed: {
+            auto it = m_cells.find(slot.cell);
+            if (it == m_cells.end()) return nullptr;
+            return &it->second[slot.team][slot.index];
+        }
+        case Backend::FlatGrid:
+            return &m_entries[slot.index];
+        case Backend::Incremental:
+            return &m_gridCells[slot.cell][slot.index];
+    }
+    return nullptr;
+}
+
+SpatialAggregate* SpatialHash::aggregateFor(const Slot& slot) {
+    if (!m_trackAggregates) return nullptr;
+    if (m_backend == Backend::Hashed) {
+        return &m_hashedAggregates[slot.cell][slot.team];
+    }
+    return &m_aggregates[slot.cell];
+}
+
+void SpatialHash::unlinkGridCell(Slot& slot) {
+    auto& part = m_gridCells[slot.cell];
+    if (slot.index + 1 != part.size()) {
+        // Swap-and-pop, then fix up the slot of the record we moved
+        part[slot.index] = part.back();
+        findSlot(part[slot.index].entity)->index = slot.index;
+    }
+    part.pop_back();
+}
+
+} // namespace fob
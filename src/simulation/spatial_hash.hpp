@@ -2,72 +2,463 @@
 
 #include "core/types.hpp"
 #include "core/constants.hpp"
+#include "components/components.hpp"
 #include <entt/entt.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 #include <cmath>
 
 namespace fob {
 
-class SpatialHash {
-public:
-    explicit SpatialHash(float cellSize = SPATIAL_HASH_CELL_SIZE)
-        : m_cellSize(cellSize), m_invCellSize(1.0f / cellSize) {}
+class JobSystem;
+
+/// World-space rectangle covered by a bounded spatial grid. Positions outside
+/// it are clamped into the border cells, so queries stay correct there, just
+/// with more candidates.
+struct GridBounds {
+    float minX = -BATTLEFIELD_HALF_EXTENT;
+    float minY = -BATTLEFIELD_HALF_EXTENT;
+    float maxX = BATTLEFIELD_HALF_EXTENT;
+    float maxY = BATTLEFIELD_HALF_EXTENT;
+};
+
+/// Packed per-entity record stored inline in the spatial index, so neighbour
+/// loops can read position and team without going back to the registry.
+/// Positions are a snapshot taken at insert() or the last move().
+struct SpatialEntry {
+    entt::entity entity = entt::null;
+    float x = 0.0f;
+    float y = 0.0f;
+    Team::Value team = Team::Red;
+    bool routing = false;
+};
+
+/// Totals over a set of records: how many, how many of them are routing, and
+/// their position sums (doubles, so incremental updates don't drift).
+struct SpatialAggregate {
+    uint32_t count = 0;
+    uint32_t routing = 0;
+    double sumX = 0.0;
+    double sumY = 0.0;
 
-    void clear() {
-        m_cells.clear();
+    void add(const SpatialEntry& entry) {
+        ++count;
+        routing += entry.routing ? 1 : 0;
+        sumX += entry.x;
+        sumY += entry.y;
     }
 
-    void insert(entt::entity entity, float x, float y) {
-        auto key = cellKey(x, y);
-        m_cells[key].push_back(entity);
+    void subtract(const SpatialEntry& entry) {
+        --count;
+        routing -= entry.routing ? 1 : 0;
+        sumX -= entry.x;
+        sumY -= entry.y;
     }
 
+    void merge(const SpatialAggregate& other) {
+        count += other.count;
+        routing += other.routing;
+        sumX += other.sumX;
+        sumY += other.sumY;
+    }
+
+    Vec2 centroid() const {
+        if (count == 0) return Vec2(0.0f, 0.0f);
+        return Vec2(static_cast<float>(sumX / count), static_cast<float>(sumY / count));
+    }
+};
+
+/// Invoke a record visitor, passing the squared distance only if it takes
+/// one, and treating a void return as "keep going". Shared by every index
+/// that hands out SpatialEntry records.
+template<typename Fn>
+bool visitSpatialEntry(Fn& fn, const SpatialEntry& entry, float distSq) {
+    if constexpr (std::is_invocable_v<Fn&, const SpatialEntry&, float>) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, const SpatialEntry&, float>>) {
+            fn(entry, distSq);
+            return true;
+        } else {
+            return fn(entry, distSq);
+        }
+    } else {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, const SpatialEntry&>>) {
+            fn(entry);
+            return true;
+        } else {
+            return fn(entry);
+        }
+    }
+}
+
+/// Uniform-grid spatial index over soldier positions.
+///
+/// Three storage backends sit behind the same insert/query API:
+/// - Hashed:      unbounded, one vector per occupied cell in a hash map.
+/// - FlatGrid:    bounded, one contiguous record array sorted by cell with a
+///                per-cell start offset table, built by a two-pass counting
+///                sort. Allocation-free once buffers have grown to the army,
+///                and buildable in parallel on the JobSystem.
+/// - Incremental: bounded, one vector per grid cell, kept current by move()
+///                and remove() so it never needs rebuilding. Only units that
+///                cross a cell boundary touch more than their own record.
+///
+/// Cells store packed SpatialEntry records, partitioned by team within each
+/// cell, so the enemy/ally query variants only scan the relevant side. Queries
+/// can return either bare entity handles or the records themselves. The
+/// forEach*InRadius visitors do the exact circle test inside the index and
+/// never copy into a buffer.
+///
+/// Usage per tick for Hashed/FlatGrid: clear(), insert() every entity,
+/// build(), then query. For Incremental: insert() everything once, then keep
+/// it current with move()/remove(). On the rebuild backends move() rewrites
+/// the record in place but leaves it in the cell it was built into, so
+/// records always carry current positions while cell-ranged queries may
+/// miss a record by up to the distance it has moved since the build;
+/// per-entity lookups (find(), and so NeighbourLists) are exact.
+///
+/// With enableAggregates(), every cell also keeps a SpatialAggregate per team,
+/// computed at build() or maintained by insert/move/remove, so wide-radius
+/// "how many, and where" queries can take cells wholly inside the circle as
+/// a unit and only scan the records of the edge cells.
+class SpatialHash {
+public:
+    enum class Backend : uint8_t { Hashed, FlatGrid, Incremental };
+
+    explicit SpatialHash(float cellSize = SPATIAL_FINE_CELL_SIZE,
+                         Backend backend = Backend::FlatGrid,
+                         GridBounds bounds = GridBounds{});
+
+    /// Keep per-cell, per-team aggregates from now on. Call before the first
+    /// insert; costs one extra pass per build and a little per move.
+    void enableAggregates();
+
+    void clear();
+
+    void insert(entt::entity entity, float x, float y, Team::Value team, bool routing = false);
+
+    /// Finalise the index after all inserts for this tick. Must be called
+    /// before querying the FlatGrid backend; a no-op for the others.
+    void build();
+
+    /// Parallel build: the grid's rows are cut into one band per thread,
+    /// balanced by records and buckets; the inserts are dealt out to the
+    /// bands, and each thread counting-sorts its band into its own bucket
+    /// range. Scratch grows with threads x rows, not with buckets, and the
+    /// result is bit-identical to build(). Uses at most one thread per 8192
+    /// records, and the serial path when that is fewer than two.
+    void build(JobSystem& jobs);
+
+    /// Update an entity's position. The record is rewritten in place; the
+    /// incremental backend also relinks it if the entity changed cell, the
+    /// rebuild backends leave that to the next build.
+    void move(entt::entity entity, float x, float y);
+
+    /// Drop an entity from the index (e.g. on death) so queries skip it.
+    void remove(entt::entity entity);
+
+    /// Update an entity's routing flag, e.g. when it breaks. Needed on the
+    /// incremental backend; the rebuild backends pick it up at insert().
+    void setRouting(entt::entity entity, bool routing);
+
+    /// The record currently indexed for entity, or nullptr if it isn't in the
+    /// index (never inserted, removed, or a stale handle).
+    const SpatialEntry* find(entt::entity entity) const;
+
+    /// Number of live records.
+    size_t size() const { return m_size; }
+
     // Query all entities within radius of point
     void queryRadius(float x, float y, float radius,
                      std::vector<entt::entity>& results) const {
         results.clear();
+        forEachCell(x - radius, y - radius, x + radius, y + radius, ALL_TEAMS,
+                    [&](const SpatialEntry* begin, const SpatialEntry* end) {
+                        for (auto* e = begin; e != end; ++e) {
+                            if (e->entity != entt::null) results.push_back(e->entity);
+                        }
+                        return true;
+                    });
+    }
 
-        int minCellX = static_cast<int>(std::floor((x - radius) * m_invCellSize));
-        int maxCellX = static_cast<int>(std::floor((x + radius) * m_invCellSize));
-        int minCellY = static_cast<int>(std::floor((y - radius) * m_invCellSize));
-        int maxCellY = static_cast<int>(std::floor((y + radius) * m_invCellSize));
-
-        for (int cy = minCellY; cy <= maxCellY; ++cy) {
-            for (int cx = minCellX; cx <= maxCellX; ++cx) {
-                auto key = packKey(cx, cy);
-                auto it = m_cells.find(key);
-                if (it != m_cells.end()) {
-                    results.insert(results.end(), it->second.begin(), it->second.end());
-                }
-            }
-        }
+    // Query packed records within radius of point (cell granularity, callers
+    // still do the exact distance test)
+    void queryRadius(float x, float y, float radius,
+                     std::vector<SpatialEntry>& results) const {
+        queryRecords(x, y, radius, ALL_TEAMS, results);
+    }
+
+    // As queryRadius, restricted to the teams hostile to / allied with `team`
+    void queryEnemies(float x, float y, float radius, Team::Value team,
+                      std::vector<SpatialEntry>& results) const {
+        queryRecords(x, y, radius, enemyMask(team), results);
+    }
+
+    void queryAllies(float x, float y, float radius, Team::Value team,
+                     std::vector<SpatialEntry>& results) const {
+        queryRecords(x, y, radius, allyMask(team), results);
     }
 
     // Query entities in same cell and neighboring cells (3x3 around point)
     void queryNearby(float x, float y, std::vector<entt::entity>& results) const {
-        results.clear();
+        queryRadius(x, y, m_cellSize, results);
+    }
 
-        int cellX = static_cast<int>(std::floor(x * m_invCellSize));
-        int cellY = static_cast<int>(std::floor(y * m_invCellSize));
+    void queryNearby(float x, float y, std::vector<SpatialEntry>& results) const {
+        queryRadius(x, y, m_cellSize, results);
+    }
 
-        for (int dy = -1; dy <= 1; ++dy) {
-            for (int dx = -1; dx <= 1; ++dx) {
-                auto key = packKey(cellX + dx, cellY + dy);
-                auto it = m_cells.find(key);
-                if (it != m_cells.end()) {
-                    results.insert(results.end(), it->second.begin(), it->second.end());
-                }
-            }
-        }
+    /// Visit every record within radius of (x, y), exact distance test included.
+    /// fn(const SpatialEntry&) may return bool; returning false stops the query.
+    /// fn may also take a second float parameter to receive the squared distance.
+    template<typename Fn>
+    void forEachInRadius(float x, float y, float radius, Fn&& fn) const {
+        forEachInRadiusMasked(x, y, radius, ALL_TEAMS, fn);
     }
 
+    /// As forEachInRadius, but always hands the callback the squared distance
+    /// so it doesn't have to recompute it: fn(const SpatialEntry&, float distSq).
+    template<typename Fn>
+    void forEachInRadiusSq(float x, float y, float radius, Fn&& fn) const {
+        forEachInRadiusMasked(x, y, radius, ALL_TEAMS, fn);
+    }
+
+    /// Visit only records hostile to `team`; same callback rules as forEachInRadius.
+    template<typename Fn>
+    void forEachEnemyInRadius(float x, float y, float radius, Team::Value team, Fn&& fn) const {
+        forEachInRadiusMasked(x, y, radius, enemyMask(team), fn);
+    }
+
+    /// Visit only records on `team` (including the caller itself, if indexed).
+    template<typename Fn>
+    void forEachAllyInRadius(float x, float y, float radius, Team::Value team, Fn&& fn) const {
+        forEachInRadiusMasked(x, y, radius, allyMask(team), fn);
+    }
+
+    /// Totals over the records on `team` within radius of (x, y). Cells wholly
+    /// inside the circle contribute their stored aggregate; edge cells are
+    /// scanned with the exact distance test, so the result is exact. Falls back
+    /// to a full scan if aggregates aren't enabled.
+    SpatialAggregate aggregateInRadius(float x, float y, float radius, Team::Value team) const;
+
+    /// As aggregateInRadius, over the teams hostile to `team`.
+    SpatialAggregate aggregateEnemiesInRadius(float x, float y, float radius, Team::Value team) const;
+
     float cellSize() const { return m_cellSize; }
+    Backend backend() const { return m_backend; }
+    bool incremental() const { return m_backend == Backend::Incremental; }
 
 private:
+    /// Bitmask over Team::Value selecting which partitions a query scans.
+    using TeamMask = uint32_t;
+    static constexpr TeamMask ALL_TEAMS = (1u << Team::COUNT) - 1;
+
+    static TeamMask allyMask(Team::Value team) { return 1u << team; }
+    static TeamMask enemyMask(Team::Value team) { return ALL_TEAMS & ~allyMask(team); }
+
+    /// Where an entity's record lives: bucket index (grid cell * Team::COUNT +
+    /// team) or hash key, plus the position within that bucket's storage (or
+    /// the flat array for FlatGrid).
+    struct Slot {
+        static constexpr int64_t NONE = INT64_MIN;  // hash keys may be negative
+
+        int64_t cell = NONE;
+        uint32_t index = 0;
+        Team::Value team = Team::Red;
+    };
+
+    /// Per-cell team partitions for the Hashed backend
+    using HashedCell = std::array<std::vector<SpatialEntry>, Team::COUNT>;
+
+    /// Inclusive range of cell coordinates
+    struct CellRange {
+        int minX, minY, maxX, maxY;
+    };
+
     float m_cellSize;
     float m_invCellSize;
-    std::unordered_map<int64_t, std::vector<entt::entity>> m_cells;
+    Backend m_backend;
+    GridBounds m_bounds;
+    int m_gridWidth = 1;
+    int m_gridHeight = 1;
+    size_t m_size = 0;
+
+    // Entity index -> record location, for move()/remove()
+    std::vector<Slot> m_slots;
+
+    // Hashed backend
+    std::unordered_map<int64_t, HashedCell> m_cells;
+
+    // FlatGrid backend
+    std::vector<SpatialEntry> m_pending;     // inserts staged until build()
+    std::vector<uint32_t> m_pendingCell;     // bucket index of each staged insert
+    std::vector<uint32_t> m_cellStart;       // bucketCount + 1 offsets into m_entries
+    std::vector<uint32_t> m_cellCursor;      // scatter write heads
+    std::vector<SpatialEntry> m_entries;     // records sorted by (cell, team)
+
+    // FlatGrid parallel build scratch
+    std::vector<uint32_t> m_threadRowCounts;  // threads x rows: records per row in each slice
+    std::vector<size_t> m_threadSlotCount;    // slot table size each slice needs
+    std::vector<uint32_t> m_rowBand;          // band each grid row belongs to
+    std::vector<uint32_t> m_bandRowStart;     // first row of each band, threads + 1
+    std::vector<uint32_t> m_bandStart;        // first record of each band, threads + 1
+    std::vector<uint32_t> m_bandHeads;        // threads x bands write heads into m_banded
+    std::vector<uint32_t> m_banded;           // insert indices grouped by band, in insertion order
+
+    // Incremental backend, one vector per bucket
+    std::vector<std::vector<SpatialEntry>> m_gridCells;
+
+    // Per-team cell aggregates, if enabled: by bucket for the grid backends,
+    // by cell key for Hashed
+    bool m_trackAggregates = false;
+    std::vector<SpatialAggregate> m_aggregates;
+    std::unordered_map<int64_t, std::array<SpatialAggregate, Team::COUNT>> m_hashedAggregates;
+
+    Slot* findSlot(entt::entity entity);
+    Slot& slotFor(entt::entity entity);
+    const SpatialEntry* entryAt(const Slot& slot) const;
+    void unlinkGridCell(Slot& slot);
+
+    /// Aggregate of the bucket/key a slot points at; nullptr when not tracking.
+    SpatialAggregate* aggregateFor(const Slot& slot);
+    void accumulateBuckets(size_t beginBucket, size_t endBucket);
+
+    SpatialAggregate aggregateMasked(float x, float y, float radius, TeamMask teams) const;
+
+    void queryRecords(float x, float y, float radius, TeamMask teams,
+                      std::vector<SpatialEntry>& results) const {
+        results.clear();
+        forEachCell(x - radius, y - radius, x + radius, y + radius, teams,
+                    [&](const SpatialEntry* begin, const SpatialEntry* end) {
+                        for (auto* e = begin; e != end; ++e) {
+                            if (e->entity != entt::null) results.push_back(*e);
+                        }
+                        return true;
+                    });
+    }
+
+    template<typename Fn>
+    void forEachInRadiusMasked(float x, float y, float radius, TeamMask teams, Fn& fn) const {
+        const float radiusSq = radius * radius;
+        forEachCell(x - radius, y - radius, x + radius, y + radius, teams,
+                    [&](const SpatialEntry* begin, const SpatialEntry* end) {
+                        for (auto* e = begin; e != end; ++e) {
+                            float dx = e->x - x;
+                            float dy = e->y - y;
+                            float distSq = dx * dx + dy * dy;
+                            if (distSq > radiusSq || e->entity == entt::null) continue;
+                            if (!visitSpatialEntry(fn, *e, distSq)) return false;
+                        }
+                        return true;
+                    });
+    }
+
+    /// Visit the record ranges of the selected team partitions of one cell.
+    /// Grid backends expect in-range cell coordinates. Returns false if the
+    /// visitor asked to stop.
+    template<typename Fn>
+    bool visitCell(int cx, int cy, TeamMask teams, Fn& fn) const {
+        if (m_backend == Backend::Hashed) {
+            auto it = m_cells.find(packKey(cx, cy));
+            if (it == m_cells.end()) return true;
+            for (int t = 0; t < Team::COUNT; ++t) {
+                const auto& part = it->second[t];
+                if ((teams & (1u << t)) && !part.empty() &&
+                    !fn(part.data(), part.data() + part.size())) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint32_t bucket = gridIndex(cx, cy) * Team::COUNT;
+        for (int t = 0; t < Team::COUNT; ++t) {
+            if (!(teams & (1u << t))) continue;
+            const SpatialEntry* begin;
+            const SpatialEntry* end;
+            if (m_backend == Backend::Incremental) {
+                const auto& part = m_gridCells[bucket + t];
+                begin = part.data();
+                end = part.data() + part.size();
+            } else {
+                begin = m_entries.data() + m_cellStart[bucket + t];
+                end = m_entries.data() + m_cellStart[bucket + t + 1];
+            }
+            if (begin != end && !fn(begin, end)) return false;
+        }
+        return true;
+    }
+
+    /// Visit the contiguous record ranges of the selected team partitions of
+    /// every cell overlapping the world-space rectangle [minX, maxX] x
+    /// [minY, maxY]. The visitor returns false to stop early. Ranges may
+    /// contain removed (null) records.
+    template<typename Fn>
+    void forEachCell(float minX, float minY, float maxX, float maxY, TeamMask teams, Fn&& fn) const {
+        if (m_backend == Backend::FlatGrid && m_cellStart.empty()) return;  // not built yet
+
+        const CellRange range = cellRange(minX, minY, maxX, maxY);
+
+        if (m_backend == Backend::FlatGrid && teams == ALL_TEAMS) {
+            // Buckets of a row are adjacent in the sorted array: one span per row
+            for (int cy = range.minY; cy <= range.maxY; ++cy) {
+                uint32_t row = gridIndex(0, cy);
+                uint32_t begin = m_cellStart[(row + range.minX) * Team::COUNT];
+                uint32_t end = m_cellStart[(row + range.maxX + 1) * Team::COUNT];
+                if (begin != end && !fn(m_entries.data() + begin, m_entries.data() + end)) {
+                    return;
+                }
+            }
+            return;
+        }
+
+        for (int cy = range.minY; cy <= range.maxY; ++cy) {
+            for (int cx = range.minX; cx <= range.maxX; ++cx) {
+                if (!visitCell(cx, cy, teams, fn)) return;
+            }
+        }
+    }
+
+    /// Cells overlapping a world-space rectangle; clamped to the grid for the
+    /// bounded backends.
+    CellRange cellRange(float minX, float minY, float maxX, float maxY) const {
+        if (m_backend == Backend::Hashed) {
+            return {static_cast<int>(std::floor(minX * m_invCellSize)),
+                    static_cast<int>(std::floor(minY * m_invCellSize)),
+                    static_cast<int>(std::floor(maxX * m_invCellSize)),
+                    static_cast<int>(std::floor(maxY * m_invCellSize))};
+        }
+        return {gridX(minX), gridY(minY), gridX(maxX), gridY(maxY)};
+    }
+
+    int gridX(float x) const {
+        int cx = static_cast<int>(std::floor((x - m_bounds.minX) * m_invCellSize));
+        return std::clamp(cx, 0, m_gridWidth - 1);
+    }
+
+    int gridY(float y) const {
+        int cy = static_cast<int>(std::floor((y - m_bounds.minY) * m_invCellSize));
+        return std::clamp(cy, 0, m_gridHeight - 1);
+    }
+
+    uint32_t gridIndex(int cx, int cy) const {
+        return static_cast<uint32_t>(cy) * static_cast<uint32_t>(m_gridWidth) + static_cast<uint32_t>(cx);
+    }
+
+    uint32_t gridCell(float x, float y) const {
+        return gridIndex(gridX(x), gridY(y));
+    }
+
+    uint32_t gridBucket(float x, float y, Team::Value team) const {
+        return gridCell(x, y) * Team::COUNT + team;
+    }
+
+    size_t bucketCount() const {
+        return static_cast<size_t>(m_gridWidth) * m_gridHeight * Team::COUNT;
+    }
 
     static int64_t packKey(int x, int y) {
         return (static_cast<int64_t>(x) << 32) | (static_cast<uint32_t>(y));
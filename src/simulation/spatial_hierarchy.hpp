@@ -0,0 +1,84 @@
+#pragma once
+
+#include "core/constants.hpp"
+#include "simulation/spatial_hash.hpp"
+#include <entt/entt.hpp>
+
+namespace fob {
+
+class JobSystem;
+
+/// Two-resolution spatial index: a fine grid for contact-range queries
+/// (separation, attack, neighbour-list rebuilds) and a coarse grid for
+/// wide-radius ones (morale, flee). Each level is a full SpatialHash over
+/// the same soldiers with the same backend, so a query pays neither the
+/// false positives of oversized cells nor the cell count of undersized ones.
+///
+/// The coarse level also keeps per-cell team aggregates (counts, centroids,
+/// routing counts) for O(cells) crowd queries.
+///
+/// Mutations go to both levels. Systems pick a level explicitly via fine() /
+/// coarse(), or let levelFor() choose by query radius.
+class SpatialHierarchy {
+public:
+    explicit SpatialHierarchy(SpatialHash::Backend backend = SpatialHash::Backend::FlatGrid,
+                              float fineCellSize = SPATIAL_FINE_CELL_SIZE,
+                              float coarseCellSize = SPATIAL_COARSE_CELL_SIZE,
+                              GridBounds bounds = GridBounds{})
+        : m_fine(fineCellSize, backend, bounds), m_coarse(coarseCellSize, backend, bounds) {
+        m_coarse.enableAggregates();
+    }
+
+    void clear() {
+        m_fine.clear();
+        m_coarse.clear();
+    }
+
+    void insert(entt::entity entity, float x, float y, Team::Value team, bool routing = false) {
+        m_fine.insert(entity, x, y, team, routing);
+        m_coarse.insert(entity, x, y, team, routing);
+    }
+
+    void build() {
+        m_fine.build();
+        m_coarse.build();
+    }
+
+    void build(JobSystem& jobs) {
+        m_fine.build(jobs);
+        m_coarse.build(jobs);
+    }
+
+    void move(entt::entity entity, float x, float y) {
+        m_fine.move(entity, x, y);
+        m_coarse.move(entity, x, y);
+    }
+
+    void remove(entt::entity entity) {
+        m_fine.remove(entity);
+        m_coarse.remove(entity);
+    }
+
+    void setRouting(entt::entity entity, bool routing) {
+        m_fine.setRouting(entity, routing);
+        m_coarse.setRouting(entity, routing);
+    }
+
+    size_t size() const { return m_fine.size(); }
+    bool incremental() const { return m_fine.incremental(); }
+
+    const SpatialHash& fine() const { return m_fine; }
+    const SpatialHash& coarse() const { return m_coarse; }
+
+    /// The level whose cells best fit a query of this radius: fine cells up
+    /// to twice their size, coarse beyond that.
+    const SpatialHash& levelFor(float radius) const {
+        return radius <= m_fine.cellSize() * 2.0f ? m_fine : m_coarse;
+    }
+
+private:
+    SpatialHash m_fine;
+    SpatialHash m_coarse;
+};
+
+} // namespace fob
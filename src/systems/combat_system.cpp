@@ -1,124 +1,180 @@
 #include "systems/combat_system.hpp"
 #include "components/components.hpp"
 #include "core/constants.hpp"
+#include <algorithm>
 #include <cmath>
 
 namespace fob {
 
 namespace {
 
-float distance(float x1, float y1, float x2, float y2) {
-    float dx = x2 - x1;
-    float dy = y2 - y1;
-    return std::sqrt(dx * dx + dy * dy);
-}
+// Soldiers stop advancing at ENEMY_STOP_RADIUS, so they must already be in
+// reach when they do
+static_assert(ATTACK_RANGE >= ENEMY_STOP_RADIUS, "Soldiers must halt within attack range");
+
+// Engaged soldiers search out to ATTACK_DISENGAGE_RANGE, wider than
+// ATTACK_RANGE so engagement has hysteresis. Searches are neighbour-list
+// queries, and movement publishes every step into the index records, so
+// both ends of a search are this tick's positions; the lists only
+// guarantee to hold everyone within NEIGHBOUR_INTERACTION_RADIUS of them
+static_assert(ATTACK_DISENGAGE_RANGE >= ATTACK_RANGE &&
+              ATTACK_DISENGAGE_RANGE <= NEIGHBOUR_INTERACTION_RADIUS,
+              "Disengage range must lie between attack range and the neighbour-list radius");
+
+// Combatants per parallel decide range
+constexpr size_t PARALLEL_COMBAT_GRAIN = 256;
+
+// Which of an attacker's rolls on a tick a draw is
+enum CombatDraw : uint32_t {
+    DrawInitialDelay,
+    DrawHit,
+    DrawDamage,
+    DrawCooldown,
+};
 
 } // anonymous namespace
 
-CombatSystem::CombatSystem()
-    : m_rng(std::random_device{}()) {}
-
-void CombatSystem::update(entt::registry& registry, const SpatialHash& spatialHash, float dt) {
-    // Decay flash effects
-    auto flashView = registry.view<FlashEffect>();
-    for (auto entity : flashView) {
-        auto& flash = flashView.get<FlashEffect>(entity);
-        if (flash.timer > 0.0f) {
-            flash.timer -= dt;
-            if (flash.timer <= 0.0f) {
-                flash.type = FlashEffect::None;
-            }
+CombatSystem::CombatSystem(uint64_t seed, FlashSystem& flashes, EventBus& events)
+    : m_rng(seed), m_flashes(flashes), m_events(events) {}
+
+void CombatSystem::update(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                          const NeighbourLists& neighbours, JobSystem& jobs, uint32_t tick) {
+    m_tick = tick;
+
+    // Ready everyone whose cooldown ends this tick. Timers of soldiers who
+    // have since left combat, died or rescheduled no longer match their state
+    m_dueTimers.clear();
+    m_attackTimers.advanceTo(tick, m_dueTimers);
+    for (auto entity : m_dueTimers) {
+        auto* state = registry.try_get<CombatState>(entity);
+        if (state && state->engaged && state->nextAttackTick == tick) {
+            state->attackReady = true;
         }
     }
 
-    // Update attack cooldowns and process attacks
-    auto combatantView = registry.view<Position, Team, Stats>(entt::exclude<Dead, Routing>);
-
+    m_combatants.clear();
+    m_states.clear();
+    auto combatantView = registry.view<Position, Team, Stats, CombatState>(entt::exclude<Dead, Routing>);
     for (auto entity : combatantView) {
-        // Update cooldown timer if in combat
-        auto* inCombat = registry.try_get<InCombat>(entity);
-        if (inCombat) {
-            inCombat->combatTimer += dt;
+        // Rigid formations have no enemy within reach by construction
+        if (auto* member = registry.try_get<FormationMember>(entity);
+            member && member->memberIndex != FormationMember::NOT_LISTED &&
+            registry.get<Formation>(member->formation).rigid) {
+            continue;
         }
 
-        // Try to find a target and attack
-        entt::entity target = findTarget(registry, spatialHash, entity);
-
-        if (target != entt::null) {
-            // We have a valid target
-            if (!inCombat) {
-                // Enter combat with randomized initial cooldown
-                registry.emplace<InCombat>(entity, target);
-                inCombat = registry.try_get<InCombat>(entity);
-                std::uniform_real_distribution<float> initialDelay(0.0f, ATTACK_COOLDOWN);
-                inCombat->combatTimer = initialDelay(m_rng);
-            } else {
-                // Update target if changed
-                inCombat->opponent = target;
-            }
-
-            // Attack if cooldown has elapsed
-            if (inCombat->combatTimer >= ATTACK_COOLDOWN) {
-                performAttack(registry, entity, target);
-                // Randomize next cooldown (1x to 2x base) to stagger attacks
-                std::uniform_real_distribution<float> cooldownVariance(0.0f, ATTACK_COOLDOWN);
-                inCombat->combatTimer = -cooldownVariance(m_rng);
-            }
-        } else {
-            // No target in range - leave combat
-            if (inCombat) {
-                registry.remove<InCombat>(entity);
-            }
+        m_combatants.push_back(entity);
+        m_states.push_back(&combatantView.get<CombatState>(entity));
+    }
+
+    // Decide phase: targets, cooldowns and rolls, against start-of-tick state
+    m_workerOutput.prepare(jobs);
+    for (auto& output : m_workerOutput) {
+        output.attacks.clear();
+        output.timers.clear();
+    }
+    const entt::registry& snapshot = registry;
+    jobs.parallelFor(0, m_combatants.size(), PARALLEL_COMBAT_GRAIN, [&](size_t begin, size_t end) {
+        decide(snapshot, neighbours, begin, end, m_workerOutput.local(jobs));
+    });
+
+    // Which worker produced an attack depends on scheduling; attacker order doesn't
+    m_attacks.clear();
+    for (const auto& output : m_workerOutput) {
+        m_attacks.insert(m_attacks.end(), output.attacks.begin(), output.attacks.end());
+        for (const auto& timer : output.timers) {
+            m_attackTimers.schedule(timer.tick, timer.entity);
         }
     }
-}
+    std::sort(m_attacks.begin(), m_attacks.end(), [](const AttackRecord& a, const AttackRecord& b) {
+        return entt::to_integral(a.attacker) < entt::to_integral(b.attacker);
+    });
 
-entt::entity CombatSystem::findTarget(entt::registry& registry, const SpatialHash& spatialHash,
-                                       entt::entity attacker) {
-    const auto& attackerPos = registry.get<Position>(attacker);
-    const auto& attackerTeam = registry.get<Team>(attacker);
+    // Apply phase
+    for (const auto& attack : m_attacks) {
+        performAttack(registry, spatialIndex, attack);
+    }
+}
 
-    spatialHash.queryRadius(attackerPos.x, attackerPos.y, ATTACK_RANGE, m_nearbyBuffer);
+void CombatSystem::decide(const entt::registry& registry, const NeighbourLists& neighbours,
+                          size_t begin, size_t end, WorkerOutput& out) const {
+    for (size_t i = begin; i < end; ++i) {
+        entt::entity entity = m_combatants[i];
+        CombatState& state = *m_states[i];
 
-    entt::entity bestTarget = entt::null;
-    float bestDist = ATTACK_RANGE + 1.0f;
+        // Try to find a target; once engaged, hold on to enemies a little
+        // beyond reach rather than dropping out of combat
+        float reach = state.engaged ? ATTACK_DISENGAGE_RANGE : ATTACK_RANGE;
+        SpatialEntry target = findTarget(registry, neighbours, entity, reach);
 
-    for (auto other : m_nearbyBuffer) {
-        if (other == attacker) continue;
-        if (!registry.valid(other)) continue;
-        if (registry.all_of<Dead>(other)) continue;
+        if (target.entity == entt::null) {
+            // No target in range - leave combat
+            state.engaged = false;
+            state.attackReady = false;
+            state.opponent = entt::null;
+            continue;
+        }
 
-        const auto* otherTeam = registry.try_get<Team>(other);
-        if (!otherTeam || otherTeam->value == attackerTeam.value) continue;  // Same team
+        const uint32_t stream = entt::to_integral(entity);
+        if (!state.engaged) {
+            // Enter combat with randomized initial cooldown: as if somewhere
+            // between 0 and a full cooldown had already passed
+            state.engaged = true;
+            state.attackReady = false;
+            float elapsed = m_rng.uniform(m_tick, stream, DrawInitialDelay, 0.0f, ATTACK_COOLDOWN);
+            scheduleAttack(entity, state, ATTACK_COOLDOWN - elapsed, out);
+        }
+        state.opponent = target.entity;
 
-        // Must have health to be a valid target
-        if (!registry.all_of<Stats>(other)) continue;
+        // Attack if cooldown has elapsed and the target is within reach
+        if (!state.attackReady) continue;
 
-        const auto& otherPos = registry.get<Position>(other);
-        float dist = distance(attackerPos.x, attackerPos.y, otherPos.x, otherPos.y);
+        const auto& pos = registry.get<Position>(entity);
+        float dx = target.x - pos.x;
+        float dy = target.y - pos.y;
+        if (dx * dx + dy * dy > ATTACK_RANGE * ATTACK_RANGE) continue;
 
-        if (dist <= ATTACK_RANGE && dist < bestDist) {
-            bestTarget = other;
-            bestDist = dist;
-        }
+        out.attacks.push_back({entity, target.entity, rollDamage(registry, entity, target.entity)});
+        // Randomize next cooldown (1x to 2x base) to stagger attacks
+        state.attackReady = false;
+        float extra = m_rng.uniform(m_tick, stream, DrawCooldown, 0.0f, ATTACK_COOLDOWN);
+        scheduleAttack(entity, state, ATTACK_COOLDOWN + extra, out);
     }
+}
 
-    return bestTarget;
+void CombatSystem::scheduleAttack(entt::entity entity, CombatState& state, float cooldown,
+                                  WorkerOutput& out) const {
+    state.nextAttackTick = m_tick + ticksFor(cooldown);
+    out.timers.push_back({entity, state.nextAttackTick});
 }
 
-void CombatSystem::performAttack(entt::registry& registry, entt::entity attacker, entt::entity target) {
-    if (!registry.valid(target)) return;
-    if (registry.all_of<Dead>(target)) return;
+SpatialEntry CombatSystem::findTarget(const entt::registry& registry, const NeighbourLists& neighbours,
+                                      entt::entity attacker, float reach) const {
+    const auto& attackerPos = registry.get<Position>(attacker);
+    const auto& attackerTeam = registry.get<Team>(attacker);
 
-    auto* targetStats = registry.try_get<Stats>(target);
-    if (!targetStats) return;
+    // Index records carry the positions movement just published, the same
+    // ones the attacker's component holds, on every backend
+    SpatialEntry best;
+    float bestDistSq = reach * reach;
+    neighbours.forEachEnemyInRadius(attacker, attackerPos.x, attackerPos.y, reach, attackerTeam.value,
+                                    [&](const SpatialEntry& other, float distSq) {
+        if (best.entity == entt::null || distSq < bestDistSq) {
+            best = other;
+            bestDistSq = distSq;
+        }
+    });
+    return best;
+}
 
-    // Flash white on attacker to show they're attacking
-    registry.emplace_or_replace<FlashEffect>(attacker, FlashEffect::Attack);
+float CombatSystem::rollDamage(const entt::registry& registry, entt::entity attacker,
+                               entt::entity target) const {
+    const auto* targetStats = registry.try_get<Stats>(target);
+    if (!targetStats) return 0.0f;
 
     // Roll for hit type
-    std::uniform_real_distribution<float> roll(0.0f, 1.0f);
-    float hitRoll = roll(m_rng);
+    const uint32_t stream = entt::to_integral(attacker);
+    float hitRoll = m_rng.uniform(m_tick, stream, DrawHit);
 
     float damage = 0.0f;
 
@@ -127,7 +183,7 @@ void CombatSystem::performAttack(entt::registry& registry, entt::entity attacker
         damage = 0.0f;
     } else {
         // Hit - determine if light or heavy
-        float damageRoll = roll(m_rng);
+        float damageRoll = m_rng.uniform(m_tick, stream, DrawDamage);
         if (damageRoll < HEAVY_HIT_CHANCE) {
             damage = HEAVY_DAMAGE;
         } else {
@@ -135,21 +191,40 @@ void CombatSystem::performAttack(entt::registry& registry, entt::entity attacker
         }
     }
 
+    if (damage <= 0.0f) return 0.0f;
+
+    // Factor in defense (simple reduction)
+    return std::max(1.0f, damage - targetStats->defense * 0.5f);
+}
+
+void CombatSystem::performAttack(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                                 const AttackRecord& attack) {
+    entt::entity target = attack.target;
+    if (!registry.valid(target)) return;
+    // Already fallen to an earlier blow this tick
+    if (registry.all_of<Dead>(target)) return;
+
+    auto* targetStats = registry.try_get<Stats>(target);
+    if (!targetStats) return;
+
+    // Flash white on attacker to show they're attacking
+    m_flashes.flash(registry, attack.attacker, FlashEffect::Attack, m_tick);
+
     // Apply damage
-    if (damage > 0.0f) {
-        // Factor in defense (simple reduction)
-        float actualDamage = std::max(1.0f, damage - targetStats->defense * 0.5f);
-        targetStats->health -= actualDamage;
+    if (attack.damage > 0.0f) {
+        targetStats->health -= attack.damage;
 
         // Flash yellow on target to show they got hit
-        registry.emplace_or_replace<FlashEffect>(target, FlashEffect::Hit);
+        m_flashes.flash(registry, target, FlashEffect::Hit, m_tick);
+        m_events.publish(HitEvent{target, attack.attacker, attack.damage});
 
         // Check for death
-        checkDeath(registry, target);
+        checkDeath(registry, spatialIndex, target, attack.attacker);
     }
 }
 
-void CombatSystem::checkDeath(entt::registry& registry, entt::entity entity) {
+void CombatSystem::checkDeath(entt::registry& registry, SpatialHierarchy& spatialIndex, entt::entity entity,
+                              entt::entity killer) {
     auto* stats = registry.try_get<Stats>(entity);
     if (!stats) return;
 
@@ -161,10 +236,20 @@ void CombatSystem::checkDeath(entt::registry& registry, entt::entity entity) {
             registry.emplace<Dead>(entity);
         }
 
-        // Remove combat-related components
-        registry.remove<InCombat>(entity);
+        // Stop showing up in neighbour queries from this point on
+        spatialIndex.remove(entity);
+
+        // Leave combat and drop combat-related tags
+        if (auto* combat = registry.try_get<CombatState>(entity)) {
+            *combat = CombatState{};
+        }
         registry.remove<Routing>(entity);
         registry.remove<Pursuing>(entity);
+
+        const auto& pos = registry.get<Position>(entity);
+        m_events.publish(DeathEvent{entity, killer, registry.get<Team>(entity).value,
+                                    registry.all_of<Officer>(entity), pos.x, pos.y});
+        m_events.publish(KillEvent{killer, entity});
     }
 }
 
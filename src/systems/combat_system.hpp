@@ -1,8 +1,14 @@
 #pragma once
 
-#include "simulation/spatial_hash.hpp"
+#include "simulation/spatial_hierarchy.hpp"
+#include "simulation/neighbour_lists.hpp"
+#include "simulation/events.hpp"
+#include "systems/flash_system.hpp"
+#include "core/job_system.hpp"
+#include "core/random.hpp"
+#include "core/timing_wheel.hpp"
 #include <entt/entt.hpp>
-#include <random>
+#include <vector>
 
 namespace fob {
 
@@ -14,31 +20,106 @@ namespace fob {
 /// 3. Attack rolls for miss/light/heavy damage
 /// 4. Damage is applied to target's health
 /// 5. Units at 0 HP are marked Dead
+///
+/// Engagement lives in each soldier's CombatState, with hysteresis: soldiers
+/// engage within ATTACK_RANGE and stay engaged until no enemy is within
+/// ATTACK_DISENGAGE_RANGE, but only strike enemies within ATTACK_RANGE.
+/// Cooldowns are scheduled on a timing wheel rather than counted down, so
+/// the timer bookkeeping per tick is proportional to the cooldowns ending.
+///
+/// Resolution is two-phase. The decide phase runs across the JobSystem:
+/// every combatant picks a target from the state before any blow lands this
+/// tick - positions as movement left them, which movement publishes into
+/// the spatial index records too - and updates its own CombatState, and any
+/// attack it rolls goes into its worker's buffer as an AttackRecord. The
+/// apply phase then sorts the attacks by attacker and, on one thread,
+/// applies damage and flashes and marks the dead. Blows are simultaneous: a
+/// soldier killed this tick still lands the attack they rolled, but attacks
+/// on a soldier who has already fallen this tick are wasted.
+///
+/// Every random roll is a pure function of (seed, tick, attacker, draw), so
+/// a battle replays exactly from its seed and results don't depend on thread
+/// count or scheduling.
+///
+/// Members of rigid formations (Formation::rigid) are left out: no enemy
+/// is anywhere near them.
+///
+/// The apply phase publishes a HitEvent for every blow that lands, and a
+/// DeathEvent and KillEvent for every soldier it kills.
 class CombatSystem {
 public:
-    CombatSystem();
+    /// @param seed Seed for every combat roll
+    /// @param flashes Shows attack and hit flashes
+    /// @param events Receives hit, death and kill events
+    CombatSystem(uint64_t seed, FlashSystem& flashes, EventBus& events);
 
     /// Process combat for all units.
     /// @param registry The ECS registry
-    /// @param spatialHash Spatial index for finding nearby enemies
-    /// @param dt Delta time
-    void update(entt::registry& registry, const SpatialHash& spatialHash, float dt);
+    /// @param spatialIndex Spatial index; the dead are removed from it as they fall
+    /// @param neighbours Cached neighbour lists used for target selection
+    /// @param jobs Scheduler for the decide phase
+    /// @param tick The simulation tick being run
+    void update(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                const NeighbourLists& neighbours, JobSystem& jobs, uint32_t tick);
 
 private:
-    /// Find the best target for a soldier to attack.
-    /// Returns entt::null if no valid target in range.
-    entt::entity findTarget(entt::registry& registry, const SpatialHash& spatialHash,
-                            entt::entity attacker);
+    /// An attack rolled by the decide phase, applied by the apply phase.
+    struct AttackRecord {
+        entt::entity attacker;
+        entt::entity target;
+        float damage;  // after the target's defense; 0 on a miss
+    };
+
+    /// A cooldown to put on the timing wheel once the decide phase is done.
+    struct AttackTimer {
+        entt::entity entity;
+        uint32_t tick;
+    };
+
+    /// What one worker's share of the decide phase produced.
+    struct WorkerOutput {
+        std::vector<AttackRecord> attacks;
+        std::vector<AttackTimer> timers;
+    };
 
-    /// Perform an attack from attacker to target.
-    /// Rolls for damage and applies it.
-    void performAttack(entt::registry& registry, entt::entity attacker, entt::entity target);
+    /// Decide phase for combatants [begin, end) of m_combatants: reads the
+    /// registry and neighbour lists, writes only each combatant's own
+    /// CombatState and `out`.
+    void decide(const entt::registry& registry, const NeighbourLists& neighbours,
+                size_t begin, size_t end, WorkerOutput& out) const;
+
+    /// Start a cooldown of `cooldown` seconds from this tick.
+    void scheduleAttack(entt::entity entity, CombatState& state, float cooldown,
+                        WorkerOutput& out) const;
+
+    /// Find the nearest enemy within `reach` of a soldier.
+    /// Returns an entry with entity entt::null if there is none.
+    SpatialEntry findTarget(const entt::registry& registry, const NeighbourLists& neighbours,
+                            entt::entity attacker, float reach) const;
+
+    /// Roll an attack's damage against the target's defense.
+    float rollDamage(const entt::registry& registry, entt::entity attacker, entt::entity target) const;
+
+    /// Apply a rolled attack: flashes, damage and possibly death.
+    void performAttack(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                       const AttackRecord& attack);
 
     /// Check if a unit should die and mark them Dead if so.
-    void checkDeath(entt::registry& registry, entt::entity entity);
+    void checkDeath(entt::registry& registry, SpatialHierarchy& spatialIndex, entt::entity entity,
+                    entt::entity killer);
+
+    CounterRng m_rng;
+    FlashSystem& m_flashes;
+    EventBus& m_events;
+    uint32_t m_tick = 0;
+
+    TimingWheel<entt::entity> m_attackTimers;
+    std::vector<entt::entity> m_dueTimers;
 
-    std::mt19937 m_rng;
-    std::vector<entt::entity> m_nearbyBuffer;
+    std::vector<entt::entity> m_combatants;
+    std::vector<CombatState*> m_states;  // parallel to m_combatants
+    PerWorker<WorkerOutput> m_workerOutput;
+    std::vector<AttackRecord> m_attacks;
 };
 
 } // namespace fob
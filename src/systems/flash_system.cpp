@@ -0,0 +1,31 @@
+#include "systems/flash_system.hpp"
+#include "core/constants.hpp"
+
+namespace fob {
+
+namespace {
+
+constexpr uint32_t FLASH_TICKS = ticksFor(FlashEffect::FLASH_DURATION);
+
+} // anonymous namespace
+
+void FlashSystem::flash(entt::registry& registry, entt::entity entity, FlashEffect::Type type,
+                        uint32_t tick) {
+    registry.emplace_or_replace<FlashEffect>(entity, type, tick + FLASH_TICKS);
+    m_expiries.schedule(tick + FLASH_TICKS, entity);
+}
+
+void FlashSystem::update(entt::registry& registry, uint32_t tick) {
+    m_expired.clear();
+    m_expiries.advanceTo(tick, m_expired);
+
+    for (auto entity : m_expired) {
+        // A flash replaced since this expiry was scheduled has a later one
+        auto* flash = registry.try_get<FlashEffect>(entity);
+        if (flash && flash->expiresAt <= tick) {
+            flash->type = FlashEffect::None;
+        }
+    }
+}
+
+} // namespace fob
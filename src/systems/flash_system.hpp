@@ -0,0 +1,33 @@
+#pragma once
+
+#include "components/components.hpp"
+#include "core/timing_wheel.hpp"
+#include <entt/entt.hpp>
+#include <vector>
+
+namespace fob {
+
+/// Owns the attack/hit flash shown by the renderer. Flashes are started
+/// through flash(), which schedules their expiry on a timing wheel; update()
+/// only visits the flashes that expire this tick rather than every flash.
+/// Only touches FlashEffect, so it runs alongside the formation and movement
+/// passes.
+class FlashSystem {
+public:
+    FlashSystem() = default;
+
+    /// Show a flash on `entity` from `tick` for FLASH_DURATION, replacing
+    /// any flash it already has.
+    void flash(entt::registry& registry, entt::entity entity, FlashEffect::Type type, uint32_t tick);
+
+    /// Clear the flashes that expire on `tick`.
+    /// @param registry The ECS registry
+    /// @param tick The simulation tick being run
+    void update(entt::registry& registry, uint32_t tick);
+
+private:
+    TimingWheel<entt::entity> m_expiries;
+    std::vector<entt::entity> m_expired;
+};
+
+} // namespace fob
@@ -1,6 +1,7 @@
 #include "systems/formation_system.hpp"
 #include "components/components.hpp"
 #include "core/constants.hpp"
+#include <algorithm>
 #include <cmath>
 
 namespace fob {
@@ -19,19 +20,50 @@ Vec2 normalize(Vec2 v) {
     return Vec2(v.x / len, v.y / len);
 }
 
+// A formation goes rigid only with no enemy within FORMATION_LOD_MARGIN of
+// its bounds. Rigid members are left out of combat and contact checks, so
+// the margin has to cover an enemy's whole reach plus the stop radius the
+// formation would have halted at
+static_assert(FORMATION_LOD_MARGIN > ATTACK_DISENGAGE_RANGE + ENEMY_STOP_RADIUS,
+              "Rigid formations must be out of reach of every enemy, with room to spread out before contact");
+
 } // anonymous namespace
 
-void FormationSystem::update(entt::registry& registry, const SpatialHash& spatialHash, float dt) {
+void FormationSystem::update(entt::registry& registry, const NeighbourLists& neighbours,
+                             const EventBus& events, float dt) {
+    // Close the ranks behind last tick's dead and routed
+    for (const auto& death : events.events<DeathEvent>()) {
+        removeMember(registry, death.entity);
+    }
+    for (const auto& rout : events.events<RoutEvent>()) {
+        removeMember(registry, rout.entity);
+    }
+
     auto formationView = registry.view<Position, Formation>();
 
+    for (auto entity : formationView) {
+        updateBounds(registry, formationView.get<Position>(entity), formationView.get<Formation>(entity));
+    }
+    gatherContactCandidates(registry);
+
     for (auto entity : formationView) {
         auto& pos = formationView.get<Position>(entity);
         auto& formation = formationView.get<Formation>(entity);
 
+        formation.rigid = false;
+
         switch (formation.state) {
             case FormationState::Advancing: {
-                // Check if we've made contact with the enemy
-                if (checkEnemyContact(registry, spatialHash, entity)) {
+                // Far from any enemy the formation marches as one block;
+                // closer in, check for contact soldier by soldier only once
+                // the broadphase finds something within reach
+                const Team::Value team = registry.get<Team>(entity).value;
+                if (!formation.members.empty()) {
+                    formation.rigid = !enemyNear(team, formation.bounds, FORMATION_LOD_MARGIN);
+                }
+                if (!formation.rigid && !formation.members.empty() &&
+                    enemyNear(team, formation.bounds, ENEMY_STOP_RADIUS) &&
+                    checkEnemyContact(registry, neighbours, entity)) {
                     formation.state = FormationState::Engaged;
                     break;
                 }
@@ -63,48 +95,148 @@ void FormationSystem::update(entt::registry& registry, const SpatialHash& spatia
     }
 }
 
-bool FormationSystem::checkEnemyContact(entt::registry& registry, const SpatialHash& spatialHash,
-                                         entt::entity formationEntity) {
-    const auto& formation = registry.get<Formation>(formationEntity);
-
-    // Get the team of this formation by checking one of its members
-    Team::Value formationTeam = Team::Red;  // default
-    bool foundTeam = false;
+void FormationSystem::updateBounds(entt::registry& registry, const Position& pos, Formation& formation) {
+    if (formation.members.empty()) return;
+
+    const SlotTransform frame = formation.slotTransform(pos.toVec2());
+    const Vec2 forward = frame.forward;
+    const Vec2 right = frame.right;
+
+    // Extent of the members along each of the formation's axes, relative to
+    // its position
+    float minX = INFINITY, maxX = -INFINITY;
+    float minY = INFINITY, maxY = -INFINITY;
+    for (auto soldier : formation.members) {
+        const auto& soldierPos = registry.get<Position>(soldier);
+        float dx = soldierPos.x - pos.x;
+        float dy = soldierPos.y - pos.y;
+        float alongRight = dx * right.x + dy * right.y;
+        float alongForward = dx * forward.x + dy * forward.y;
+        minX = std::min(minX, alongRight);
+        maxX = std::max(maxX, alongRight);
+        minY = std::min(minY, alongForward);
+        maxY = std::max(maxY, alongForward);
+    }
 
-    // Find front-line soldiers (rank 0) in this formation
-    auto memberView = registry.view<Position, FormationMember, Team>(entt::exclude<Dead, Routing>);
+    float midX = (minX + maxX) * 0.5f;
+    float midY = (minY + maxY) * 0.5f;
+    formation.bounds.center = Vec2(pos.x + right.x * midX + forward.x * midY,
+                                   pos.y + right.y * midX + forward.y * midY);
+    formation.bounds.forward = forward;
+    formation.bounds.halfExtents = Vec2((maxX - minX) * 0.5f, (maxY - minY) * 0.5f);
+}
 
-    for (auto soldier : memberView) {
-        const auto& member = memberView.get<FormationMember>(soldier);
-        if (member.formation != formationEntity) continue;
+void FormationSystem::gatherContactCandidates(entt::registry& registry) {
+    m_candidates.clear();
 
-        if (!foundTeam) {
-            formationTeam = memberView.get<Team>(soldier).value;
-            foundTeam = true;
-        }
+    auto formationView = registry.view<Formation, Team>();
+    for (auto entity : formationView) {
+        const auto& formation = formationView.get<Formation>(entity);
+        if (formation.members.empty()) continue;
+        m_candidates.push_back({formationView.get<Team>(entity).value, formation.bounds});
+    }
 
-        // Only check front-line soldiers
-        if (member.rank != formation.frontRank) continue;
+    // Soldiers who have left the ranks or never had any aren't in any
+    // formation's bounds
+    auto routingView = registry.view<Position, Team, Routing>(entt::exclude<Dead>);
+    for (auto entity : routingView) {
+        m_candidates.push_back({routingView.get<Team>(entity).value,
+                                OrientedBox::point(routingView.get<Position>(entity).toVec2())});
+    }
+    auto freeView = registry.view<Position, Team, MovementTarget>(entt::exclude<Dead, Routing, FormationMember>);
+    for (auto entity : freeView) {
+        m_candidates.push_back({freeView.get<Team>(entity).value,
+                                OrientedBox::point(freeView.get<Position>(entity).toVec2())});
+    }
+}
 
-        const auto& soldierPos = memberView.get<Position>(soldier);
+bool FormationSystem::enemyNear(Team::Value team, const OrientedBox& box, float margin) const {
+    for (const auto& candidate : m_candidates) {
+        if (candidate.team != team && box.near(candidate.box, margin)) return true;
+    }
+    return false;
+}
 
-        // Check for nearby enemies
-        spatialHash.queryRadius(soldierPos.x, soldierPos.y, ENEMY_STOP_RADIUS, m_nearbyBuffer);
+bool FormationSystem::checkEnemyContact(entt::registry& registry, const NeighbourLists& neighbours,
+                                         entt::entity formationEntity) {
+    const auto& formation = registry.get<Formation>(formationEntity);
+    const Team::Value formationTeam = registry.get<Team>(formationEntity).value;
 
-        for (auto other : m_nearbyBuffer) {
-            if (other == soldier) continue;
-            if (!registry.valid(other)) continue;
-            if (registry.all_of<Dead>(other)) continue;
+    // Check the soldiers standing in the front rank
+    for (int file = 0; file < formation.files; ++file) {
+        entt::entity soldier = formation.occupant(formation.frontRank, file);
+        if (soldier == entt::null) continue;
 
-            const auto* otherTeam = registry.try_get<Team>(other);
-            if (!otherTeam || otherTeam->value == formationTeam) continue;
+        const auto& soldierPos = registry.get<Position>(soldier);
 
+        // Check for nearby enemies
+        bool contact = false;
+        neighbours.forEachEnemyInRadius(soldier, soldierPos.x, soldierPos.y, ENEMY_STOP_RADIUS, formationTeam,
+                                        [&](const SpatialEntry&) {
             // Found an enemy near a front-line soldier
-            return true;
-        }
+            contact = true;
+            return false;
+        });
+        if (contact) return true;
     }
 
     return false;
 }
 
+void FormationSystem::addMember(entt::registry& registry, entt::entity soldier) {
+    auto& member = registry.get<FormationMember>(soldier);
+    auto& formation = registry.get<Formation>(member.formation);
+
+    member.memberIndex = static_cast<uint32_t>(formation.members.size());
+    formation.members.push_back(soldier);
+    if (formation.inGrid(member.rank, member.file)) {
+        formation.place(member.rank, member.file) = soldier;
+    }
+}
+
+void FormationSystem::removeMember(entt::registry& registry, entt::entity soldier) {
+    auto* member = registry.try_get<FormationMember>(soldier);
+    if (!member || member->memberIndex == FormationMember::NOT_LISTED) return;
+
+    auto& formation = registry.get<Formation>(member->formation);
+    if (formation.occupant(member->rank, member->file) == soldier) {
+        formation.place(member->rank, member->file) = entt::null;
+    }
+
+    // Swap-remove: the last member takes the leaver's slot
+    auto& members = formation.members;
+    entt::entity last = members.back();
+    members[member->memberIndex] = last;
+    registry.get<FormationMember>(last).memberIndex = member->memberIndex;
+    members.pop_back();
+
+    member->memberIndex = FormationMember::NOT_LISTED;
+}
+
+void FormationSystem::transferMember(entt::registry& registry, entt::entity soldier,
+                                     entt::entity formation, Vec2 localOffset, int rank, int file) {
+    removeMember(registry, soldier);
+
+    auto& member = registry.get<FormationMember>(soldier);
+    member.formation = formation;
+    member.localOffset = localOffset;
+    member.rank = rank;
+    member.file = file;
+    addMember(registry, soldier);
+}
+
+void FormationSystem::promoteMember(entt::registry& registry, entt::entity soldier) {
+    auto& member = registry.get<FormationMember>(soldier);
+    auto& formation = registry.get<Formation>(member.formation);
+
+    if (!formation.inGrid(member.rank - 1, member.file)) return;
+
+    if (formation.occupant(member.rank, member.file) == soldier) {
+        formation.place(member.rank, member.file) = entt::null;
+    }
+    member.rank--;
+    member.localOffset.y += FORMATION_SPACING;  // One rank toward the front
+    formation.place(member.rank, member.file) = soldier;
+}
+
 } // namespace fob
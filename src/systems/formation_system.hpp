@@ -1,8 +1,11 @@
 #pragma once
 
 #include "core/types.hpp"
-#include "simulation/spatial_hash.hpp"
+#include "core/oriented_box.hpp"
+#include "simulation/neighbour_lists.hpp"
+#include "simulation/events.hpp"
 #include <entt/entt.hpp>
+#include <vector>
 
 namespace fob {
 
@@ -16,23 +19,73 @@ namespace fob {
 /// - Advancing → Engaged: When front-line soldiers contact enemies
 /// - Engaged → Advancing: (TODO) When ordered to push or enemies retreat
 /// - Any → Broken: (TODO) When morale collapses
+///
+/// Each formation keeps a dense list of the soldiers in its ranks
+/// (Formation::members), so per-formation work visits only that
+/// formation's soldiers. Soldiers who died or routed last tick are dropped
+/// from the list, from the event bus, at the start of each update. Each
+/// formation also keeps a rank x file grid of who stands where, so finding
+/// the front rank or a gap in the file ahead is a lookup.
+///
+/// Contact detection has a broadphase: every formation's bounds are
+/// refreshed each tick, and an advancing formation only checks its front
+/// rank soldier by soldier once an enemy formation's bounds (or a soldier
+/// outside any formation) come within ENEMY_STOP_RADIUS of its own. The same
+/// test at FORMATION_LOD_MARGIN decides which advancing formations are far
+/// enough from any enemy to move as rigid blocks (Formation::rigid).
 class FormationSystem {
 public:
     FormationSystem() = default;
 
     /// Update all formations for one simulation tick.
     /// @param registry The ECS registry
-    /// @param spatialHash Spatial index for finding nearby enemies
+    /// @param neighbours Cached neighbour lists for finding nearby enemies
+    /// @param events Last tick's events; deaths and routs leave the ranks
     /// @param dt Delta time (should be FIXED_TIMESTEP)
-    void update(entt::registry& registry, const SpatialHash& spatialHash, float dt);
+    void update(entt::registry& registry, const NeighbourLists& neighbours,
+                const EventBus& events, float dt);
+
+    /// Enlist a soldier in a formation's member list. The soldier's
+    /// FormationMember must already point at the formation and not be listed.
+    static void addMember(entt::registry& registry, entt::entity soldier);
+
+    /// Take a soldier out of their formation's member list, if they are in it.
+    /// The FormationMember stays, still naming the formation.
+    static void removeMember(entt::registry& registry, entt::entity soldier);
+
+    /// Move a soldier into another formation at the given rank and file,
+    /// which must be empty.
+    static void transferMember(entt::registry& registry, entt::entity soldier,
+                               entt::entity formation, Vec2 localOffset, int rank, int file);
+
+    /// Step a soldier up into the empty place directly ahead of them in their
+    /// file, one rank nearer the front. Does nothing if that place is off
+    /// the grid.
+    static void promoteMember(entt::registry& registry, entt::entity soldier);
 
 private:
+    /// Something hostile a formation could run into: another formation's
+    /// bounds, or a lone soldier as a point.
+    struct ContactCandidate {
+        Team::Value team;
+        OrientedBox box;
+    };
+
+    /// Fit a formation's bounds to its members' current positions.
+    static void updateBounds(entt::registry& registry, const Position& pos, Formation& formation);
+
+    /// Collect every formation's bounds and every living soldier outside a
+    /// formation (routing or free) as contact candidates.
+    void gatherContactCandidates(entt::registry& registry);
+
+    /// Broadphase: could anything hostile to `team` be within `margin` of `box`?
+    bool enemyNear(Team::Value team, const OrientedBox& box, float margin) const;
+
     /// Check if any front-line soldiers in this formation are in contact with enemies.
-    bool checkEnemyContact(entt::registry& registry, const SpatialHash& spatialHash,
+    bool checkEnemyContact(entt::registry& registry, const NeighbourLists& neighbours,
                            entt::entity formationEntity);
 
-    // Scratch buffer for spatial queries
-    std::vector<entt::entity> m_nearbyBuffer;
+    std::vector<ContactCandidate> m_candidates;
 };
 
 } // namespace fob
@@ -1,12 +1,17 @@
 #include "systems/movement_system.hpp"
+#include "systems/formation_system.hpp"
 #include "components/components.hpp"
 #include "core/constants.hpp"
+#include <algorithm>
 #include <cmath>
 
 namespace fob {
 
 namespace {
 
+// Formation members per parallel range
+constexpr size_t PARALLEL_MOVEMENT_GRAIN = 256;
+
 float getBaseSpeed(UnitType::Type type) {
     switch (type) {
         case UnitType::LightInfantry: return LIGHT_INFANTRY_SPEED;
@@ -37,240 +42,278 @@ Vec2 clampMagnitude(Vec2 v, float maxLen) {
 
 } // anonymous namespace
 
-void MovementSystem::update(entt::registry& registry, const SpatialHash& spatialHash, float dt) {
-    // Process routing units first (they flee from enemies, ignore formation)
-    auto routingView = registry.view<Position, Velocity, UnitType, Routing>(entt::exclude<Dead, InCombat>);
+void MovementSystem::update(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                            const NeighbourLists& neighbours, JobSystem& jobs, float dt) {
+    // Nothing below writes a Position or touches the spatial index until
+    // publishMoves(), so every unit sees the start-of-tick positions
+    m_pendingMoves.clear();
+
+    // Process routing units (they flee from enemies, ignore formation)
+    auto routingView = registry.view<Position, Velocity, UnitType, Routing, CombatState>(entt::exclude<Dead>);
     for (auto entity : routingView) {
+        if (routingView.get<CombatState>(entity).engaged) continue;
+
         const auto& unitType = routingView.get<UnitType>(entity);
         float speed = getBaseSpeed(unitType.type) * 1.5f;
-        fleeFromEnemies(registry, entity, spatialHash, speed, dt);
+        fleeFromEnemies(registry, entity, spatialIndex, speed, dt);
     }
 
-    // Process formation members
-    auto formationMemberView = registry.view<Position, Velocity, FormationMember, Team, UnitType>(
-        entt::exclude<Dead, InCombat, Routing>);
-
-    for (auto entity : formationMemberView) {
-        const auto& member = formationMemberView.get<FormationMember>(entity);
-        const auto& unitType = formationMemberView.get<UnitType>(entity);
-        float speed = getBaseSpeed(unitType.type);
-
-        // Get formation state
-        if (!registry.valid(member.formation)) continue;
-        const auto* formation = registry.try_get<Formation>(member.formation);
-        const auto* formationPos = registry.try_get<Position>(member.formation);
-        if (!formation || !formationPos) continue;
-
-        moveFormationMember(registry, entity, spatialHash, *formation, *formationPos, speed, dt);
+    // Process formation members as one batch: gather them into SoA arrays,
+    // then steer and integrate ranges of the batch in parallel
+    gatherFormationMembers(registry, dt);
+
+    m_scratch.prepare(jobs);
+    jobs.parallelFor(0, m_batch.size(), PARALLEL_MOVEMENT_GRAIN, [&](size_t begin, size_t end) {
+        steerFormationMembers(neighbours, begin, end, m_scratch.local(jobs));
+        integrateBatch(m_batch, begin, end, dt);
+    });
+
+    // Each gap has only the one soldier behind it to fill it, so promotions
+    // never compete and can be applied in any order
+    for (size_t i = 0; i < m_batch.size(); ++i) {
+        if (m_batch.promote[i]) {
+            FormationSystem::promoteMember(registry, m_batch.entity[i]);
+        }
     }
 
     // Process units with MovementTarget but no formation (free units)
-    auto freeUnitView = registry.view<Position, Velocity, MovementTarget, Team, UnitType>(
-        entt::exclude<Dead, InCombat, Routing, FormationMember>);
+    auto freeUnitView = registry.view<Position, Velocity, MovementTarget, Team, UnitType, CombatState>(
+        entt::exclude<Dead, Routing, FormationMember>);
 
     for (auto entity : freeUnitView) {
+        if (freeUnitView.get<CombatState>(entity).engaged) continue;
+
         const auto& target = freeUnitView.get<MovementTarget>(entity);
         if (!target.hasTarget) continue;
 
         const auto& unitType = freeUnitView.get<UnitType>(entity);
         float speed = getBaseSpeed(unitType.type);
-        moveFreeUnit(registry, entity, spatialHash, speed, dt);
+        moveFreeUnit(registry, entity, neighbours, speed, dt, m_scratch.local(jobs));
     }
-}
 
-void MovementSystem::moveFormationMember(entt::registry& registry, entt::entity entity,
-                                          const SpatialHash& spatialHash,
-                                          const Formation& formation, const Position& formationPos,
-                                          float speed, float dt) {
-    auto& pos = registry.get<Position>(entity);
-    auto& vel = registry.get<Velocity>(entity);
-    const auto& member = registry.get<FormationMember>(entity);
-    const auto& team = registry.get<Team>(entity);
+    // Swap buffers: publish every new position at once
+    publishMoves(spatialIndex);
+}
 
-    // Calculate target position in world space
-    // Local offset is relative to formation center, rotated by facing
-    Vec2 targetWorld;
-    targetWorld.x = formationPos.x + member.localOffset.x;
-    targetWorld.y = formationPos.y + member.localOffset.y * formation.facing.y;
-
-    // Query nearby units for collision
-    float queryRadius = std::max(ENEMY_STOP_RADIUS, ALLY_SEPARATION_RADIUS);
-    spatialHash.queryRadius(pos.x, pos.y, queryRadius, m_nearbyBuffer);
-
-    // Calculate forces from nearby units
-    Vec2 enemyRepulsion(0.0f, 0.0f);
-    Vec2 allyRepulsion(0.0f, 0.0f);
-    bool enemyContact = false;
-
-    for (auto other : m_nearbyBuffer) {
-        if (other == entity) continue;
-        if (!registry.valid(other)) continue;
-        if (registry.all_of<Dead>(other)) continue;
-
-        const auto* otherTeam = registry.try_get<Team>(other);
-        if (!otherTeam) continue;
-
-        const auto& otherPos = registry.get<Position>(other);
-        float dist = distance(pos.x, pos.y, otherPos.x, otherPos.y);
-        if (dist < 0.01f) continue;
-
-        Vec2 away((pos.x - otherPos.x) / dist, (pos.y - otherPos.y) / dist);
-
-        if (otherTeam->value != team.value) {
-            // Enemy
-            if (dist < ENEMY_STOP_RADIUS) {
-                enemyContact = true;
-                float strength = (ENEMY_STOP_RADIUS - dist) / ENEMY_STOP_RADIUS;
-                enemyRepulsion.x += away.x * strength * 2.0f;
-                enemyRepulsion.y += away.y * strength * 2.0f;
-            }
-        } else {
-            // Ally
-            if (dist < ALLY_SEPARATION_RADIUS) {
-                float strength = (ALLY_SEPARATION_RADIUS - dist) / ALLY_SEPARATION_RADIUS;
-                allyRepulsion.x += away.x * strength;
-                allyRepulsion.y += away.y * strength;
+void MovementSystem::gatherFormationMembers(entt::registry& registry, float dt) {
+    MovementBatch& batch = m_batch;
+    batch.clear();
+
+    // Walk each formation's member list; it only holds soldiers still in
+    // the ranks, so the dead and routing never come up
+    auto formationView = registry.view<Position, Formation>();
+    for (auto formationEntity : formationView) {
+        const auto& formation = formationView.get<Formation>(formationEntity);
+        const SlotTransform slots = formation.slotTransform(formationView.get<Position>(formationEntity).toVec2());
+
+        if (formation.rigid) {
+            // No enemy anywhere near: the block moves as one, each soldier
+            // heading straight for their slot at no more than their own
+            // speed, as the batch would move them
+            for (auto entity : formation.members) {
+                auto& pos = registry.get<Position>(entity);
+                Vec2 slot = slots.apply(registry.get<FormationMember>(entity).localOffset);
+                float speed = getBaseSpeed(registry.get<UnitType>(entity).type);
+                Vec2 velocity = clampMagnitude(Vec2((slot.x - pos.x) / dt, (slot.y - pos.y) / dt), speed);
+                m_pendingMoves.push_back({entity, &pos, &registry.get<Velocity>(entity),
+                                          pos.x + velocity.x * dt, pos.y + velocity.y * dt,
+                                          velocity.x, velocity.y});
             }
+            continue;
         }
-    }
-
-    // Build movement vector based on formation state
-    Vec2 movement(0.0f, 0.0f);
 
-    if (formation.state == FormationState::Advancing && !enemyContact) {
-        // Move toward formation position
-        float distToTarget = distance(pos.x, pos.y, targetWorld.x, targetWorld.y);
-        if (distToTarget > 0.5f) {
-            Vec2 toTarget = normalize(Vec2(targetWorld.x - pos.x, targetWorld.y - pos.y));
-            // Move faster if far from position, slower if close
-            float urgency = std::min(distToTarget / FORMATION_SPACING, 1.0f);
-            movement.x += toTarget.x * speed * urgency;
-            movement.y += toTarget.y * speed * urgency;
-        }
-    } else if (formation.state == FormationState::Engaged || enemyContact) {
-        // Check if there's a gap in front to fill (replacement behavior)
-        bool allyInFront = false;
-        Vec2 frontCheckPos(pos.x, pos.y + formation.facing.y * FORMATION_SPACING);
-
-        // Query for allies directly in front of us (same file, one rank ahead)
-        // Use larger radius to account for spatial hash cell boundaries
-        float queryRadius = FORMATION_SPACING * 1.5f;
-        spatialHash.queryRadius(frontCheckPos.x, frontCheckPos.y, queryRadius, m_nearbyBuffer);
-
-        for (auto other : m_nearbyBuffer) {
-            if (other == entity) continue;
-            if (!registry.valid(other)) continue;
-            if (registry.all_of<Dead>(other)) continue;
-
-            const auto* otherTeam = registry.try_get<Team>(other);
-            if (!otherTeam || otherTeam->value != team.value) continue;
-
-            const auto& otherPos = registry.get<Position>(other);
-
-            // Check actual distance to frontCheckPos (spatial hash returns all in cells)
-            float dx = otherPos.x - frontCheckPos.x;
-            float dy = otherPos.y - frontCheckPos.y;
-            float distSq = dx * dx + dy * dy;
-            float checkRadius = FORMATION_SPACING * 0.7f;  // Slightly larger than half spacing
-
-            if (distSq < checkRadius * checkRadius) {
-                allyInFront = true;
-                break;
-            }
+        for (auto entity : formation.members) {
+            if (registry.get<CombatState>(entity).engaged) continue;
+
+            auto& pos = registry.get<Position>(entity);
+            const auto& member = registry.get<FormationMember>(entity);
+            Vec2 slot = slots.apply(member.localOffset);
+            batch.entity.push_back(entity);
+            batch.position.push_back(&pos);
+            batch.velocity.push_back(&registry.get<Velocity>(entity));
+            batch.member.push_back(&member);
+            batch.formation.push_back(&formation);
+            batch.team.push_back(registry.get<Team>(entity).value);
+            batch.posX.push_back(pos.x);
+            batch.posY.push_back(pos.y);
+            batch.slotX.push_back(slot.x);
+            batch.slotY.push_back(slot.y);
+            batch.forwardX.push_back(slots.forward.x);
+            batch.forwardY.push_back(slots.forward.y);
+            batch.speed.push_back(getBaseSpeed(registry.get<UnitType>(entity).type));
         }
+    }
 
-        if (!allyInFront && member.rank > 0) {
-            // No ally in front - advance to fill the gap
-            // Update formation position so this becomes our new "home"
-            auto& mutableMember = registry.get<FormationMember>(entity);
-            mutableMember.localOffset.y += FORMATION_SPACING;  // Move one rank forward (toward front)
-            mutableMember.rank--;
+    batch.resizeOutputs();
+}
 
-            // Recalculate target position with updated offset
-            targetWorld.x = formationPos.x + mutableMember.localOffset.x;
-            targetWorld.y = formationPos.y + mutableMember.localOffset.y * formation.facing.y;
-        }
+void MovementSystem::steerFormationMembers(const NeighbourLists& neighbours, size_t begin, size_t end,
+                                           SeparationScratch& scratch) {
+    MovementBatch& batch = m_batch;
+
+    for (size_t i = begin; i < end; ++i) {
+        const entt::entity entity = batch.entity[i];
+        const float x = batch.posX[i];
+        const float y = batch.posY[i];
+        const float speed = batch.speed[i];
+        const Team::Value team = batch.team[i];
+        const Formation& formation = *batch.formation[i];
+        const FormationMember& member = *batch.member[i];
+
+        // Our place in the formation, already in world space, and the
+        // formation's (unit) forward direction
+        Vec2 targetWorld(batch.slotX[i], batch.slotY[i]);
+        const Vec2 forward(batch.forwardX[i], batch.forwardY[i]);
+
+        // Calculate forces from nearby units
+        SeparationForces forces = separationForces(neighbours, entity, x, y, team, scratch);
+        const bool enemyContact = forces.enemyContact;
+
+        // Build movement vector based on formation state
+        Vec2 movement(0.0f, 0.0f);
+
+        if (formation.state == FormationState::Advancing && !enemyContact) {
+            // Move toward formation position
+            float distToTarget = distance(x, y, targetWorld.x, targetWorld.y);
+            if (distToTarget > 0.5f) {
+                Vec2 toTarget = normalize(Vec2(targetWorld.x - x, targetWorld.y - y));
+                // Move faster if far from position, slower if close
+                float urgency = std::min(distToTarget / FORMATION_SPACING, 1.0f);
+                movement.x += toTarget.x * speed * urgency;
+                movement.y += toTarget.y * speed * urgency;
+            }
+        } else if (formation.state == FormationState::Engaged || enemyContact) {
+            // Check if there's a gap in front to fill (replacement behavior):
+            // is anyone standing one rank ahead in our file?
+            bool allyInFront = formation.occupant(member.rank - 1, member.file) != entt::null;
+
+            if (!allyInFront && formation.inGrid(member.rank - 1, member.file)) {
+                // No ally in front - advance to fill the gap. Our home in the
+                // formation moves one rank forward (toward front)
+                batch.promote[i] = 1;
+                targetWorld.x += forward.x * FORMATION_SPACING;
+                targetWorld.y += forward.y * FORMATION_SPACING;
+            }
 
-        if (!allyInFront) {
-            // Move toward the (possibly updated) formation position
-            movement.x += formation.facing.x * speed * 0.5f;
-            movement.y += formation.facing.y * speed * 0.5f;
-        }
+            if (!allyInFront) {
+                // Move toward the (possibly updated) formation position
+                movement.x += forward.x * speed * 0.5f;
+                movement.y += forward.y * speed * 0.5f;
+            }
 
-        if (enemyContact || allyInFront) {
-            // Hold position - only apply minor drift toward formation spot
-            float distToTarget = distance(pos.x, pos.y, targetWorld.x, targetWorld.y);
-            if (distToTarget > FORMATION_SPACING * 0.5f) {
-                Vec2 toTarget = normalize(Vec2(targetWorld.x - pos.x, targetWorld.y - pos.y));
-                movement.x += toTarget.x * speed * 0.3f;  // Gentle drift
-                movement.y += toTarget.y * speed * 0.3f;
+            if (enemyContact || allyInFront) {
+                // Hold position - only apply minor drift toward formation spot
+                float distToTarget = distance(x, y, targetWorld.x, targetWorld.y);
+                if (distToTarget > FORMATION_SPACING * 0.5f) {
+                    Vec2 toTarget = normalize(Vec2(targetWorld.x - x, targetWorld.y - y));
+                    movement.x += toTarget.x * speed * 0.3f;  // Gentle drift
+                    movement.y += toTarget.y * speed * 0.3f;
+                }
             }
         }
+
+        batch.moveX[i] = movement.x;
+        batch.moveY[i] = movement.y;
+        batch.enemyRepX[i] = forces.enemyX;
+        batch.enemyRepY[i] = forces.enemyY;
+        batch.allyRepX[i] = forces.allyX;
+        batch.allyRepY[i] = forces.allyY;
     }
+}
 
-    // Apply enemy repulsion (highest priority)
-    enemyRepulsion = normalize(enemyRepulsion);
-    movement.x += enemyRepulsion.x * speed * 1.5f;
-    movement.y += enemyRepulsion.y * speed * 1.5f;
+SeparationForces MovementSystem::separationForces(const NeighbourLists& neighbours, entt::entity entity,
+                                                  float x, float y, Team::Value team,
+                                                  SeparationScratch& scratch) {
+    // Pack the candidates within the larger of the two push radii; the kernel
+    // applies the per-team radius itself
+    const float queryRadius = std::max(ENEMY_STOP_RADIUS, ALLY_SEPARATION_RADIUS);
+
+    scratch.x.clear();
+    scratch.y.clear();
+    scratch.team.clear();
+    neighbours.forEachInRadius(entity, x, y, queryRadius, [&](const SpatialEntry& other) {
+        if (other.entity == entity) return;
+        scratch.x.push_back(other.x);
+        scratch.y.push_back(other.y);
+        scratch.team.push_back(other.team);
+    });
+
+    return computeSeparation(x, y, team, scratch.x.data(), scratch.y.data(),
+                             scratch.team.data(), scratch.x.size());
+}
 
-    // Apply ally separation
-    allyRepulsion = normalize(allyRepulsion);
-    movement.x += allyRepulsion.x * ALLY_SEPARATION_STRENGTH;
-    movement.y += allyRepulsion.y * ALLY_SEPARATION_STRENGTH;
+void MovementSystem::integrateBatch(MovementBatch& batch, size_t begin, size_t end, float dt) {
+    const float* speed = batch.speed.data();
+    const float* moveX = batch.moveX.data();
+    const float* moveY = batch.moveY.data();
+    const float* enemyRepX = batch.enemyRepX.data();
+    const float* enemyRepY = batch.enemyRepY.data();
+    const float* allyRepX = batch.allyRepX.data();
+    const float* allyRepY = batch.allyRepY.data();
+    float* velX = batch.velX.data();
+    float* velY = batch.velY.data();
+    const float* posX = batch.posX.data();
+    const float* posY = batch.posY.data();
+    float* nextX = batch.nextX.data();
+    float* nextY = batch.nextY.data();
+
+    // Straight-line float math over contiguous arrays, written with selects
+    // rather than early-outs so the compiler can vectorise it
+    for (size_t i = begin; i < end; ++i) {
+        // Enemy repulsion (highest priority), normalised to 1.5x speed
+        float enemyLen = std::sqrt(enemyRepX[i] * enemyRepX[i] + enemyRepY[i] * enemyRepY[i]);
+        float enemyScale = enemyLen < 0.0001f ? 0.0f : speed[i] * 1.5f / enemyLen;
+
+        // Ally separation, normalised to a fixed strength
+        float allyLen = std::sqrt(allyRepX[i] * allyRepX[i] + allyRepY[i] * allyRepY[i]);
+        float allyScale = allyLen < 0.0001f ? 0.0f : ALLY_SEPARATION_STRENGTH / allyLen;
+
+        float mx = moveX[i] + enemyRepX[i] * enemyScale + allyRepX[i] * allyScale;
+        float my = moveY[i] + enemyRepY[i] * enemyScale + allyRepY[i] * allyScale;
+
+        // Clamp to the soldier's speed
+        float len = std::sqrt(mx * mx + my * my);
+        float clampScale = (len <= speed[i] || len < 0.0001f) ? 1.0f : speed[i] / len;
+
+        velX[i] = mx * clampScale;
+        velY[i] = my * clampScale;
+        nextX[i] = posX[i] + velX[i] * dt;
+        nextY[i] = posY[i] + velY[i] * dt;
+    }
+}
 
-    // Clamp and apply
-    movement = clampMagnitude(movement, speed);
-    vel.dx = movement.x;
-    vel.dy = movement.y;
+void MovementSystem::publishMoves(SpatialHierarchy& spatialIndex) {
+    const MovementBatch& batch = m_batch;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch.velocity[i]->dx = batch.velX[i];
+        batch.velocity[i]->dy = batch.velY[i];
+        batch.position[i]->x = batch.nextX[i];
+        batch.position[i]->y = batch.nextY[i];
+        spatialIndex.move(batch.entity[i], batch.nextX[i], batch.nextY[i]);
+    }
 
-    pos.x += vel.dx * dt;
-    pos.y += vel.dy * dt;
+    for (const auto& move : m_pendingMoves) {
+        move.velocity->dx = move.dx;
+        move.velocity->dy = move.dy;
+        move.position->x = move.x;
+        move.position->y = move.y;
+        spatialIndex.move(move.entity, move.x, move.y);
+    }
 }
 
 void MovementSystem::moveFreeUnit(entt::registry& registry, entt::entity entity,
-                                   const SpatialHash& spatialHash, float speed, float dt) {
+                                   const NeighbourLists& neighbours, float speed, float dt,
+                                   SeparationScratch& scratch) {
     auto& pos = registry.get<Position>(entity);
     auto& vel = registry.get<Velocity>(entity);
     const auto& target = registry.get<MovementTarget>(entity);
     const auto& team = registry.get<Team>(entity);
 
-    // Query nearby units
-    float queryRadius = std::max(ENEMY_STOP_RADIUS, ALLY_SEPARATION_RADIUS);
-    spatialHash.queryRadius(pos.x, pos.y, queryRadius, m_nearbyBuffer);
-
-    Vec2 enemyRepulsion(0.0f, 0.0f);
-    Vec2 allyRepulsion(0.0f, 0.0f);
-    bool enemyInRange = false;
-
-    for (auto other : m_nearbyBuffer) {
-        if (other == entity) continue;
-        if (!registry.valid(other)) continue;
-        if (registry.all_of<Dead>(other)) continue;
-
-        const auto* otherTeam = registry.try_get<Team>(other);
-        if (!otherTeam) continue;
-
-        const auto& otherPos = registry.get<Position>(other);
-        float dist = distance(pos.x, pos.y, otherPos.x, otherPos.y);
-        if (dist < 0.01f) continue;
-
-        Vec2 away((pos.x - otherPos.x) / dist, (pos.y - otherPos.y) / dist);
-
-        if (otherTeam->value != team.value) {
-            if (dist < ENEMY_STOP_RADIUS) {
-                enemyInRange = true;
-                float strength = (ENEMY_STOP_RADIUS - dist) / ENEMY_STOP_RADIUS;
-                enemyRepulsion.x += away.x * strength * 2.0f;
-                enemyRepulsion.y += away.y * strength * 2.0f;
-            }
-        } else {
-            if (dist < ALLY_SEPARATION_RADIUS) {
-                float strength = (ALLY_SEPARATION_RADIUS - dist) / ALLY_SEPARATION_RADIUS;
-                allyRepulsion.x += away.x * strength;
-                allyRepulsion.y += away.y * strength;
-            }
-        }
-    }
+    // Forces from nearby units
+    SeparationForces forces = separationForces(neighbours, entity, pos.x, pos.y, team.value, scratch);
+    Vec2 enemyRepulsion(forces.enemyX, forces.enemyY);
+    Vec2 allyRepulsion(forces.allyX, forces.allyY);
+    bool enemyInRange = forces.enemyContact;
 
     Vec2 movement(0.0f, 0.0f);
 
@@ -292,52 +335,35 @@ void MovementSystem::moveFreeUnit(entt::registry& registry, entt::entity entity,
     movement.y += allyRepulsion.y * ALLY_SEPARATION_STRENGTH;
 
     movement = clampMagnitude(movement, speed);
-    vel.dx = movement.x;
-    vel.dy = movement.y;
-
-    pos.x += vel.dx * dt;
-    pos.y += vel.dy * dt;
+    m_pendingMoves.push_back({entity, &pos, &vel,
+                              pos.x + movement.x * dt, pos.y + movement.y * dt,
+                              movement.x, movement.y});
 }
 
 void MovementSystem::fleeFromEnemies(entt::registry& registry, entt::entity entity,
-                                      const SpatialHash& spatialHash, float speed, float dt) {
+                                      const SpatialHierarchy& spatialIndex, float speed, float dt) {
     auto& pos = registry.get<Position>(entity);
     auto& vel = registry.get<Velocity>(entity);
     const auto& team = registry.get<Team>(entity);
 
-    spatialHash.queryRadius(pos.x, pos.y, MORALE_EFFECT_RADIUS, m_nearbyBuffer);
+    // Run away from the mass of nearby enemies, taken from the coarse grid's
+    // per-cell aggregates rather than visiting each enemy
+    SpatialAggregate enemies = spatialIndex.coarse().aggregateEnemiesInRadius(
+        pos.x, pos.y, MORALE_EFFECT_RADIUS, team.value);
 
     Vec2 fleeDir(0.0f, 0.0f);
-    int enemyCount = 0;
-
-    for (auto other : m_nearbyBuffer) {
-        if (other == entity) continue;
-        if (!registry.valid(other)) continue;
-        if (registry.all_of<Dead>(other)) continue;
-
-        const auto* otherTeam = registry.try_get<Team>(other);
-        if (!otherTeam || otherTeam->value == team.value) continue;
-
-        const auto& otherPos = registry.get<Position>(other);
-        float dist = distance(pos.x, pos.y, otherPos.x, otherPos.y);
-        if (dist < 0.1f) continue;
-
-        float weight = 1.0f / dist;
-        fleeDir.x += (pos.x - otherPos.x) * weight;
-        fleeDir.y += (pos.y - otherPos.y) * weight;
-        enemyCount++;
-    }
-
-    if (enemyCount == 0) {
-        fleeDir = (team.value == Team::Red) ? Vec2(0.0f, -1.0f) : Vec2(0.0f, 1.0f);
+    if (enemies.count > 0) {
+        Vec2 centroid = enemies.centroid();
+        fleeDir = Vec2(pos.x - centroid.x, pos.y - centroid.y);
     }
 
     Vec2 dir = normalize(fleeDir);
-    vel.dx = dir.x * speed;
-    vel.dy = dir.y * speed;
-
-    pos.x += vel.dx * dt;
-    pos.y += vel.dy * dt;
+    if (dir.x == 0.0f && dir.y == 0.0f) {
+        dir = (team.value == Team::Red) ? Vec2(0.0f, -1.0f) : Vec2(0.0f, 1.0f);
+    }
+    m_pendingMoves.push_back({entity, &pos, &vel,
+                              pos.x + dir.x * speed * dt, pos.y + dir.y * speed * dt,
+                              dir.x * speed, dir.y * speed});
 }
 
 } // namespace fob
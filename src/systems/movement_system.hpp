@@ -1,8 +1,12 @@
 #pragma once
 
 #include "core/types.hpp"
-#include "simulation/spatial_hash.hpp"
+#include "simulation/spatial_hierarchy.hpp"
+#include "simulation/neighbour_lists.hpp"
+#include "simulation/separation_kernel.hpp"
+#include "core/job_system.hpp"
 #include <entt/entt.hpp>
+#include <vector>
 
 namespace fob {
 
@@ -10,39 +14,154 @@ namespace fob {
 ///
 /// Behavior varies by unit state:
 /// - Normal units: Move toward MovementTarget at their speed
-/// - InCombat units: Held in place, no movement
-/// - Routing units: Flee away from nearest enemy at 1.5x speed
+/// - Engaged units (CombatState::engaged): Held in place, no movement
+/// - Routing units: Flee at 1.5x speed, directly away from the centroid of
+///   the enemies within MORALE_EFFECT_RADIUS (from coarse-grid aggregates)
+/// - Formation members: Batched; gathered into SoA arrays, steered, then
+///   integrated together
+/// - Members of rigid formations (Formation::rigid): Moved straight toward
+///   their slots at their speed, with no steering or separation
 /// - Dead units: No movement
 ///
 /// Speed is determined by UnitType (cavalry > light > heavy infantry).
 /// Movement stops when within MELEE_RANGE of target.
+///
+/// Positions are double-buffered: every unit decides its move from the
+/// positions at the start of the tick (components and spatial index), the
+/// new positions go to separate buffers, and they are all published at the
+/// end. Results don't depend on iteration order, so the formation-member
+/// pass can be split across the JobSystem and stay deterministic.
 class MovementSystem {
 public:
     MovementSystem() = default;
 
     /// Update all unit positions for one simulation tick.
     /// @param registry The ECS registry
-    /// @param spatialHash Spatial index for finding nearby enemies (used for routing)
+    /// @param spatialIndex Spatial index for wide-radius queries; moved units are
+    ///        pushed back into it so its records stay current for combat
+    /// @param neighbours Cached neighbour lists for separation and gap checks
+    /// @param jobs Scheduler for the formation-member pass
     /// @param dt Delta time (should be FIXED_TIMESTEP)
-    void update(entt::registry& registry, const SpatialHash& spatialHash, float dt);
+    void update(entt::registry& registry, SpatialHierarchy& spatialIndex,
+                const NeighbourLists& neighbours, JobSystem& jobs, float dt);
 
 private:
-    /// Move a formation member toward their position in formation.
-    void moveFormationMember(entt::registry& registry, entt::entity entity,
-                             const SpatialHash& spatialHash,
-                             const struct Formation& formation, const struct Position& formationPos,
-                             float speed, float dt);
+    /// Structure-of-arrays working set for the formation-member pass. The
+    /// component pointers are only valid for the duration of one update().
+    struct MovementBatch {
+        // Gathered
+        std::vector<entt::entity> entity;
+        std::vector<Position*> position;
+        std::vector<Velocity*> velocity;
+        std::vector<const FormationMember*> member;
+        std::vector<const Formation*> formation;
+        std::vector<Team::Value> team;
+        std::vector<float> posX, posY;          // previous-tick positions, read-only during the pass
+        std::vector<float> slotX, slotY;        // world position of each soldier's place in formation
+        std::vector<float> forwardX, forwardY;  // formation's unit forward direction
+        std::vector<float> speed;
+
+        // Steering output: intended movement and raw repulsion sums
+        std::vector<float> moveX, moveY;
+        std::vector<float> enemyRepX, enemyRepY;
+        std::vector<float> allyRepX, allyRepY;
+
+        // Integration output
+        std::vector<float> velX, velY;
+        std::vector<float> nextX, nextY;
+
+        // Soldiers stepping up into a gap in the rank ahead, applied once
+        // the pass is done
+        std::vector<uint8_t> promote;
+
+        size_t size() const { return entity.size(); }
+
+        void clear() {
+            entity.clear();
+            position.clear();
+            velocity.clear();
+            member.clear();
+            formation.clear();
+            team.clear();
+            posX.clear();
+            posY.clear();
+            slotX.clear();
+            slotY.clear();
+            forwardX.clear();
+            forwardY.clear();
+            speed.clear();
+        }
+
+        void resizeOutputs() {
+            for (auto* column : {&moveX, &moveY, &enemyRepX, &enemyRepY,
+                                 &allyRepX, &allyRepY, &velX, &velY, &nextX, &nextY}) {
+                column->resize(size());
+            }
+            promote.assign(size(), 0);
+        }
+    };
+
+    /// Packed neighbour buffers for the separation kernel, one per worker
+    /// thread.
+    struct SeparationScratch {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<int32_t> team;
+    };
+
+    /// A free, routing or rigidly moved unit's next position and velocity,
+    /// held back until every unit has moved.
+    struct PendingMove {
+        entt::entity entity;
+        Position* position;
+        Velocity* velocity;
+        float x, y;
+        float dx, dy;
+    };
+
+    /// Collect every movable formation member, formation by formation, from
+    /// the formations' member lists, and place each one's slot in the world
+    /// with their formation's transform for this tick. Members of rigid
+    /// formations skip the batch and are queued to head straight for their
+    /// slots, at no more than their own speed.
+    void gatherFormationMembers(entt::registry& registry, float dt);
+
+    /// Neighbour forces and formation behaviour (advance, hold, fill gaps)
+    /// for gathered soldiers [begin, end). Gaps are read from the formation's
+    /// start-of-tick grid; soldiers who step up into one are only marked in
+    /// `promote`, so nothing shared is written during the pass.
+    void steerFormationMembers(const NeighbourLists& neighbours, size_t begin, size_t end,
+                               SeparationScratch& scratch);
+
+    /// Gather the neighbours of a soldier into packed arrays and run the
+    /// (SIMD-dispatched) separation kernel over them.
+    static SeparationForces separationForces(const NeighbourLists& neighbours, entt::entity entity,
+                                             float x, float y, Team::Value team,
+                                             SeparationScratch& scratch);
+
+    /// Combine intent and repulsion, clamp to speed and integrate positions
+    /// into the next-position buffer, for soldiers [begin, end).
+    static void integrateBatch(MovementBatch& batch, size_t begin, size_t end, float dt);
 
     /// Move a free unit (no formation) toward their movement target.
     void moveFreeUnit(entt::registry& registry, entt::entity entity,
-                      const SpatialHash& spatialHash, float speed, float dt);
+                      const NeighbourLists& neighbours, float speed, float dt,
+                      SeparationScratch& scratch);
 
-    /// Move a routing unit away from enemies.
+    /// Move a routing unit directly away from the centroid of the enemies
+    /// within MORALE_EFFECT_RADIUS, or toward their own side if there are
+    /// none. The flee radius is far wider than the neighbour lists, so this
+    /// reads the coarse spatial grid's per-cell aggregates directly.
     void fleeFromEnemies(entt::registry& registry, entt::entity entity,
-                         const SpatialHash& spatialHash, float speed, float dt);
+                         const SpatialHierarchy& spatialIndex, float speed, float dt);
+
+    /// Write every buffered position and velocity back to the components and
+    /// the spatial index.
+    void publishMoves(SpatialHierarchy& spatialIndex);
 
-    // Scratch buffer for spatial queries (avoids per-frame allocation)
-    std::vector<entt::entity> m_nearbyBuffer;
+    MovementBatch m_batch;
+    PerWorker<SeparationScratch> m_scratch;
+    std::vector<PendingMove> m_pendingMoves;
 };
 
 } // namespace fob
@@ -49,7 +49,7 @@ void RenderSystem::render(entt::registry& registry) {
             r = r / 2;
             g = g / 2;
             b = b / 2;
-        } else if (registry.all_of<InCombat>(entity)) {
+        } else if (auto* combat = registry.try_get<CombatState>(entity); combat && combat->engaged) {
             // Units in combat are brighter
             r = std::min(255, r + 30);
             g = std::min(255, g + 30);